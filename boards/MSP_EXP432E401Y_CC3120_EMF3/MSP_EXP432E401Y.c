@@ -94,6 +94,81 @@ const ADC_Config ADC_config[MSP_EXP432E401Y_ADCCOUNT] = {
 
 const uint_least8_t ADC_count = MSP_EXP432E401Y_ADCCOUNT;
 
+/*
+ *  =============================== ADCBuf ===============================
+ */
+#include <ti/drivers/ADCBuf.h>
+#include <ti/drivers/adcbuf/ADCBufMSP432E4.h>
+
+/* ADCBuf objects */
+ADCBufMSP432E4_Object adcbufMSP432E4Objects[MSP_EXP432E401Y_ADCBUFCOUNT];
+
+/*
+ * The same pins as the ADC channels above, but sampled by ADC1 so the
+ * DMA channels (24 and 25) don't collide with SSI3 on 14 and 15.  Each
+ * channel has its own sequencer so they can be sampled together.
+ */
+ADCBufMSP432E4_Channels adcBuf0MSP432E4Channels[MSP_EXP432E401Y_ADCBUF0CHANNELCOUNT] = {
+    {
+        .adcPin = ADCBufMSP432E4_PD_5_A6,
+        .adcSequence = ADCBufMSP432E4_Seq_0,
+        .adcInputMode = ADCBufMSP432E4_SINGLE_ENDED,
+        .adcDifferentialPin = ADCBufMSP432E4_PIN_NONE,
+        .adcInternalSource = ADCBufMSP432E4_INTERNAL_SOURCE_MODE_OFF,
+        .refVoltage = 3300000
+    },
+    {
+        .adcPin = ADCBufMSP432E4_PE_2_A1,
+        .adcSequence = ADCBufMSP432E4_Seq_1,
+        .adcInputMode = ADCBufMSP432E4_SINGLE_ENDED,
+        .adcDifferentialPin = ADCBufMSP432E4_PIN_NONE,
+        .adcInternalSource = ADCBufMSP432E4_INTERNAL_SOURCE_MODE_OFF,
+        .refVoltage = 3300000
+    }
+};
+
+/* ADC sequencer priorities for SS0-SS3, set to 0-3, 0 is highest priority */
+ADCBufMSP432E4_SequencePriorities seqPriorities[ADCBufMSP432E4_SEQUENCER_COUNT] = {
+    ADCBufMSP432E4_Priority_0,
+    ADCBufMSP432E4_Priority_1,
+    ADCBufMSP432E4_Seq_Disable,
+    ADCBufMSP432E4_Seq_Disable
+};
+
+/* ADC sequencer trigger sources for SS0-SS3 */
+ADCBufMSP432E4_TriggerSource triggerSource[ADCBufMSP432E4_SEQUENCER_COUNT] = {
+    ADCBufMSP432E4_TIMER_TRIGGER,
+    ADCBufMSP432E4_TIMER_TRIGGER,
+    ADCBufMSP432E4_TIMER_TRIGGER,
+    ADCBufMSP432E4_TIMER_TRIGGER
+};
+
+/* ADCBuf configuration structure */
+const ADCBufMSP432E4_HWAttrsV1 adcbufMSP432E4HWAttrs[MSP_EXP432E401Y_ADCBUFCOUNT] = {
+    {
+        .intPriority = ~0,
+        .adcBase = ADC1_BASE,
+        .channelSetting = adcBuf0MSP432E4Channels,
+        .sequencePriority = seqPriorities,
+        .adcTriggerSource = triggerSource,
+        .modulePhase = ADCBufMSP432E4_Phase_Delay_0,
+        .refSource = ADCBufMSP432E4_VREF_INTERNAL,
+        .useDMA = 1,
+        /* TIMER0-1 belong to SYS/BIOS, TIMER3 to the neopixels */
+        .adcTimerSource = TIMER2_BASE
+    }
+};
+
+const ADCBuf_Config ADCBuf_config[MSP_EXP432E401Y_ADCBUFCOUNT] = {
+    {
+        .fxnTablePtr = &ADCBufMSP432E4_fxnTable,
+        .object = &adcbufMSP432E4Objects[MSP_EXP432E401Y_ADCBUF0],
+        .hwAttrs = &adcbufMSP432E4HWAttrs[MSP_EXP432E401Y_ADCBUF0]
+    }
+};
+
+const uint_least8_t ADCBuf_count = MSP_EXP432E401Y_ADCBUFCOUNT;
+
 /*
  *  ============================= Display =============================
  */
@@ -65,6 +65,27 @@ typedef enum MSP_EXP432E401Y_ADCName {
     MSP_EXP432E401Y_ADCCOUNT
 } MSP_EXP432E401Y_ADCName;
 
+/*!
+ *  @def    MSP_EXP432E401Y_ADCBufName
+ *  @brief  Enum of ADCBuf hardware peripherals on the MSP_EXP432E401Y dev board
+ */
+typedef enum MSP_EXP432E401Y_ADCBufName {
+    MSP_EXP432E401Y_ADCBUF0 = 0,
+
+    MSP_EXP432E401Y_ADCBUFCOUNT
+} MSP_EXP432E401Y_ADCBufName;
+
+/*!
+ *  @def    MSP_EXP432E401Y_ADCBuf0ChannelName
+ *  @brief  Enum of ADCBuf channels, in the same order as the ADC channels
+ */
+typedef enum MSP_EXP432E401Y_ADCBuf0ChannelName {
+    MSP_EXP432E401Y_ADCBUF0CHANNEL0 = 0,    // Speaker
+    MSP_EXP432E401Y_ADCBUF0CHANNEL1,        // Hall Effect
+
+    MSP_EXP432E401Y_ADCBUF0CHANNELCOUNT
+} MSP_EXP432E401Y_ADCBuf0ChannelName;
+
 /*!
  *  @def    MSP_EXP432E401Y_GPIOName
  *  @brief  Enum of LED names on the MSP_EXP432E401Y dev board
@@ -11,9 +11,11 @@
 #define MICROPY_PY_NETWORK_NDK       (0)   /* TI NDK Ethernet */
 #define MICROPY_PY_NETWORK_WIFI      (1)   /* TI WiFi */
 #define MICROPY_PY_TILDA             (1)   /* TiLDA module */
+#define MICROPY_HW_I2C_SHARED        MSP_EXP432E401Y_I2C4 /* machine.I2C id shared with tildaThread */
 #define MICROPY_HW_HAS_NEOPIX        (1)
 #define MICROPY_MACHINE_NVSBDEV      (1)
-#define MICROPY_MACHINE_SD           (0)
+#define MICROPY_MACHINE_SD           (0)   /* needs an SD_config; the badge has no slot */
+// #define MICROPY_HW_SD             (0)   /* SD_config index to mount on /sd at boot */
 #define MICROPY_HW_USB_REPL          (1)   /* Enable the USB and REPL */
 #define MICROPY_HW_USB_MSC           (1)   /* Only enable this is USB_REPL is also enabled */
 #define MICROPY_HW_UART_REPL         MSP_EXP432E401Y_UART0
@@ -28,6 +30,13 @@
 #define MICROPY_HW_ENABLE_STORAGE    (1)
 #define MICROPY_HW_ENABLE_INTERNAL_FLASH_STORAGE (1)
 
+// Put the flash FAT volume on the log-structured layer in flash_ftl.c:
+// wear levelled and safe against resets, but 812K instead of 1M.  An
+// existing volume is copied over at boot, into the sectors it isn't using,
+// and stays as it is (mounted read-only) until the copy has been checked;
+// one too full to fit stays read-only until a factory reset.
+#define MICROPY_HW_FLASH_FTL         (0)
+
 #if MICROPY_HW_ENABLE_INTERNAL_FLASH_STORAGE
 // Provide block device macros if internal flash storage is enabled
 #define MICROPY_HW_BDEV_IOCTL flash_bdev_ioctl
@@ -42,6 +51,12 @@
 #define MICROPY_HW_UGFX_PIN_CS      MSP_EXP432E401Y_LCD_CS
 #define MICROPY_HW_UGFX_PIN_RST     MSP_EXP432E401Y_GPIO_LCD_RST
 #define MICROPY_HW_UGFX_PIN_A0      MSP_EXP432E401Y_GPIO_LCD_DCX
+#define MICROPY_HW_UGFX_PIN_TEAR    MSP_EXP432E401Y_GPIO_LCD_TEAR
+// SDRAM pool for uGFX objects, image caches and decoders; the rest of the
+// 8M goes to the GC heap
+#define MICROPY_HW_UGFX_HEAP_SIZE   (320 * 1024)
+#else
+#define MICROPY_HW_UGFX_HEAP_SIZE   (0)
 #endif
 
 #define MICROPY_HW_LED1             MSP_EXP432E401Y_GPIO_LED1
@@ -49,6 +64,11 @@
 #define MICROPY_HW_MODE_GPIO        MSP_EXP432E401Y_GPIO_BTN_MENU
 #define MICROPY_HW_MODE_GPIO_STATE  (0)
 
+// Internal SRAM for the pystack and machine.fastram(), on top of the
+// TI-RTOS HeapMem (HEAPSIZE in the .lds)
+#define MICROPY_HW_PYSTACK_SIZE     (8 * 1024)
+#define MICROPY_HW_FASTRAM_SIZE     (16 * 1024)
+
 // The volume label used when creating the flash filesystem
 #ifndef MICROPY_HW_FLASH_FS_LABEL
 #define MICROPY_HW_FLASH_FS_LABEL "tildamk4"
@@ -5,8 +5,12 @@ LD = "$(GCC_ARMCOMPILER)/bin/arm-none-eabi-gcc"
 AR = "$(GCC_ARMCOMPILER)/bin/arm-none-eabi-ar"
 SIZE = "$(GCC_ARMCOMPILER)/bin/arm-none-eabi-size"
 
-# do we want uGFX?
+# do we want uGFX?  The board build needs the define as well as the
+# library, since mpex.c sizes the GC heap around the uGFX pool
 MICROPY_PY_UGFX ?= 1
+ifeq ($(MICROPY_PY_UGFX),1)
+CFLAGS += -DMICROPY_PY_UGFX=1
+endif
 
 USBLIB_LIBS = \
     "-L$(SIMPLELINK_MSP432E4_SDK_INSTALL_DIR)/source/ti/usblib/msp432e4/lib/gcc/m4f" \
@@ -46,6 +46,7 @@
 #include <ti/drivers/SD.h>
 #include <ti/drivers/NVS.h>
 #include <ti/drivers/ADC.h>
+#include <ti/drivers/ADCBuf.h>
 
 #include <ti/drivers/net/wifi/slnetifwifi.h>
 
@@ -53,7 +54,7 @@
 
 // Micropython RTOS thread stack size
 #define STACKSIZE (8192U + 4096U)
-#define MPHEAPSIZE (8388608 - 630000) // 8 Meg SRAM - GFX_OS_HEAP_SIZE (630K)
+#define MPHEAPSIZE (8388608 - MICROPY_HW_UGFX_HEAP_SIZE) // 8 Meg SRAM - uGFX pool
 
 // Simplelink network task
 #define SLNET_IF_WIFI_PRIO       (5)
@@ -61,6 +62,7 @@
 #define SPAWN_TASK_PRIORITY      9
 
 extern void CC3120_fwUpdate(void);
+extern void boot_profile_mark(const char *phase);
 
 extern int mp_main(void * heap, uint32_t heapsize, uint32_t stacksize, UART_Handle uart);
 
@@ -95,6 +97,8 @@ void *mainThread(void *arg0)
     struct sched_param priParam;
     int32_t retc = 0;
 
+    boot_profile_mark("start");
+
     /* Initialize SlNetSock layer with CC3x20 interface                      */
     SlNetIf_init(0);
     SlNetIf_add(SLNETIF_ID_1, "CC3220", (const SlNetIf_Config_t *)&SlNetIfConfigWifi, SLNET_IF_WIFI_PRIO);
@@ -116,8 +120,12 @@ void *mainThread(void *arg0)
     PWM_init();
     NVS_init();
     ADC_init();
+    ADCBuf_init();
+    boot_profile_mark("drivers");
 
+    /* Needs UART0 before mpThread takes it for the REPL, so can't be deferred */
     CC3120_fwUpdate();
+    boot_profile_mark("cc3120 fw check");
 
     pthread_t thread;
     pthread_attr_t attrs;
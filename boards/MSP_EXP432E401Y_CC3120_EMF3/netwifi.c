@@ -53,6 +53,10 @@ static uint32_t currButton, prevButton;
 
 //extern void startNTP(void);
 
+// from modmachine.h, which isn't on this Makefile's include path
+#define MACHINE_WLAN_WAKE (20)
+extern void machine_wake(uint32_t reason);
+
 void SimpleLinkHttpServerEventHandler(
         SlNetAppHttpServerEvent_t *pSlHttpServerEvent,
         SlNetAppHttpServerResponse_t *pSlHttpServerResponse)
@@ -75,6 +79,8 @@ void SimpleLinkNetAppRequestMemFreeEventHandler(uint8_t *buffer)
  */
 void SimpleLinkWlanEventHandler(SlWlanEvent_t *pArgs)
 {
+    machine_wake(MACHINE_WLAN_WAKE);
+
     switch (pArgs->Id) {
         case SL_WLAN_EVENT_CONNECT:
             deviceConnected = true;
@@ -149,6 +155,8 @@ void SimpleLinkFatalErrorEventHandler(SlDeviceFatal_t *slFatalErrorEvent)
  */
 void SimpleLinkNetAppEventHandler(SlNetAppEvent_t *pArgs)
 {
+    machine_wake(MACHINE_WLAN_WAKE);
+
     switch (pArgs->Id) {
         case SL_NETAPP_EVENT_IPV4_ACQUIRED:
             ipAcquired = true;
@@ -164,7 +172,7 @@ void SimpleLinkNetAppEventHandler(SlNetAppEvent_t *pArgs)
  */
 void SimpleLinkSockEventHandler(SlSockEvent_t *pArgs)
 {
-
+    machine_wake(MACHINE_WLAN_WAKE);
 }
 
 /*
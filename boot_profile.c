@@ -0,0 +1,82 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include "boot_profile.h"
+
+typedef struct _boot_mark_t {
+    char name[BOOT_PROFILE_NAME_LEN];
+    uint32_t us;    // since the first mark
+} boot_mark_t;
+
+static boot_mark_t marks[BOOT_PROFILE_MAX_MARKS];
+static uint32_t num_marks;
+static uint32_t cold_marks;
+static bool soft_reset_seen;
+
+// Marks can be added from python at any time, so times come from the
+// 64-bit Timestamp count (Timestamp_get32() wraps every ~35s at 120MHz).
+// They are kept in microseconds as 32 bits, which covers 71 minutes.
+static uint64_t first_stamp;
+static uint32_t cycles_per_us;
+
+void boot_profile_mark(const char *phase) {
+    xdc_runtime_Types_Timestamp64 stamp;
+    Timestamp_get64(&stamp);
+    uint64_t now = ((uint64_t)stamp.hi << 32) | stamp.lo;
+
+    if (cycles_per_us == 0) {
+        xdc_runtime_Types_FreqHz freq;
+        Timestamp_getFreq(&freq);
+        cycles_per_us = freq.lo / 1000000u;
+        if (cycles_per_us == 0) {
+            cycles_per_us = 1;
+        }
+        first_stamp = now;
+    }
+
+    uint32_t elapsed_us = (now - first_stamp) / cycles_per_us;
+
+    if (num_marks < BOOT_PROFILE_MAX_MARKS) {
+        boot_mark_t *m = &marks[num_marks++];
+        strncpy(m->name, phase, BOOT_PROFILE_NAME_LEN - 1);
+        m->name[BOOT_PROFILE_NAME_LEN - 1] = '\0';
+        m->us = elapsed_us;
+    }
+}
+
+void boot_profile_soft_reset(void) {
+    if (!soft_reset_seen) {
+        // everything up to the first pass through mp_main is cold boot
+        soft_reset_seen = true;
+        cold_marks = num_marks;
+    }
+    else {
+        num_marks = cold_marks;
+    }
+    boot_profile_mark("soft reset");
+}
+
+uint32_t boot_profile_count(void) {
+    return num_marks;
+}
+
+const char *boot_profile_name(uint32_t i) {
+    return marks[i].name;
+}
+
+uint32_t boot_profile_us(uint32_t i) {
+    return marks[i].us;
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef BOOT_PROFILE_INCLUDE_H
+#define BOOT_PROFILE_INCLUDE_H
+
+#include <stdint.h>
+
+#define BOOT_PROFILE_MAX_MARKS  (32)
+#define BOOT_PROFILE_NAME_LEN   (20)
+
+// Record the end of a boot phase.  Safe to call before the MicroPython
+// runtime is up; names are copied.
+extern void boot_profile_mark(const char *phase);
+
+// Drop the marks made since the previous soft reset, keeping the cold
+// boot phases, and start timing the new soft reset.
+extern void boot_profile_soft_reset(void);
+
+extern uint32_t boot_profile_count(void);
+extern const char *boot_profile_name(uint32_t i);
+extern uint32_t boot_profile_us(uint32_t i);
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <xdc/std.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/drivers/UART.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+#include <ti/drivers/dpl/MutexP.h>
+
+#include "py/mpconfig.h"
+#include "console_tx.h"
+
+#if MICROPY_HW_USB_REPL
+#include "CDCD.h"
+#endif
+
+// The drain task runs at the priority of the MicroPython task, so it
+// writes while the VM sleeps, waits or yields in its poll hook, and never
+// preempts it.  Running bytecode never yields, so a write that ends a line
+// does, or print("working...") before a long computation would sit in the
+// buffer until it was over (or lost, if it never is).
+#define CONSOLE_TX_PRIORITY     (1)
+#define CONSOLE_TX_STACKSIZE    (1536)
+#define CONSOLE_TX_WAIT         (10)    // ms between checks for room
+#define TX_MASK                 (MICROPY_HW_CONSOLE_TX_SIZE - 1)
+
+static char tx_buf[MICROPY_HW_CONSOLE_TX_SIZE];
+
+// free running counts of bytes queued and written; head is only moved
+// under tx_lock, tail only by whoever is draining
+static volatile uint32_t tx_head;
+static volatile uint32_t tx_tail;
+
+static SemaphoreP_Handle tx_ready;
+static SemaphoreP_Handle tx_space;
+static MutexP_Handle tx_lock;
+
+static UART_Handle tx_uart;
+#if MICROPY_HW_USB_REPL
+static CDCD_Handle tx_cdc;
+#endif
+static volatile bool tx_direct = true;
+static volatile uint32_t tx_channels = CONSOLE_TX_USB | CONSOLE_TX_UART;
+static volatile uint32_t tx_policy = CONSOLE_TX_BLOCK;
+static volatile uint32_t tx_dropped;
+
+static void write_out(const char *str, size_t len) {
+    #if MICROPY_HW_USB_REPL
+    if (tx_cdc && (tx_channels & CONSOLE_TX_USB)) {
+        CDCD_sendData(tx_cdc, (const unsigned char *)str, len, 1);
+    }
+    #endif
+    if (tx_uart && (tx_channels & CONSOLE_TX_UART)) {
+        UART_write(tx_uart, str, len);
+    }
+}
+
+static void write_direct(const char *str, size_t len, bool cooked) {
+    const char *last = str;
+    const char *end = str + len;
+    while (cooked && (str = memchr(str, '\n', end - str))) {
+        if (str > last) {
+            write_out(last, str - last);
+        }
+        write_out("\r\n", 2);
+        last = ++str;
+    }
+    if (end > last) {
+        write_out(last, end - last);
+    }
+}
+
+// Writes out the oldest contiguous run in the buffer, returning false if
+// it is empty.
+static bool drain_chunk(void) {
+    uint32_t tail = tx_tail;
+    uint32_t len = tx_head - tail;
+    if (len == 0) {
+        return false;
+    }
+    uint32_t offset = tail & TX_MASK;
+    if (len > MICROPY_HW_CONSOLE_TX_SIZE - offset) {
+        len = MICROPY_HW_CONSOLE_TX_SIZE - offset;
+    }
+    write_out(tx_buf + offset, len);
+    tx_tail = tail + len;
+    return true;
+}
+
+static void *console_tx_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        SemaphoreP_pend(tx_ready, SemaphoreP_WAIT_FOREVER);
+        while (!tx_direct && drain_chunk()) {
+            SemaphoreP_post(tx_space);
+        }
+    }
+    return NULL;
+}
+
+void console_tx_init(UART_Handle uart) {
+    tx_uart = uart;
+}
+
+void console_tx_start(void *cdc) {
+    #if MICROPY_HW_USB_REPL
+    tx_cdc = cdc;
+    #else
+    (void)cdc;
+    #endif
+
+    tx_ready = SemaphoreP_createBinary(0);
+    tx_space = SemaphoreP_createBinary(0);
+    tx_lock = MutexP_create(NULL);
+    if (tx_ready == NULL || tx_space == NULL || tx_lock == NULL) {
+        // keep writing synchronously
+        return;
+    }
+
+    pthread_t thread;
+    pthread_attr_t attrs;
+    struct sched_param param;
+
+    pthread_attr_init(&attrs);
+    param.sched_priority = CONSOLE_TX_PRIORITY;
+    pthread_attr_setschedparam(&attrs, &param);
+    pthread_attr_setstacksize(&attrs, CONSOLE_TX_STACKSIZE);
+    if (pthread_create(&thread, &attrs, console_tx_task, NULL) == 0) {
+        tx_direct = false;
+    }
+    pthread_attr_destroy(&attrs);
+}
+
+static void copy_in(uint32_t head, const char *str, size_t len) {
+    uint32_t offset = head & TX_MASK;
+    size_t first = MICROPY_HW_CONSOLE_TX_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(tx_buf + offset, str, first);
+    memcpy(tx_buf, str + first, len - first);
+}
+
+void console_tx_write(const char *str, size_t len, bool cooked) {
+    if (tx_direct) {
+        write_direct(str, len, cooked);
+        return;
+    }
+
+    bool line = memchr(str, '\n', len) != NULL;
+    uintptr_t key = MutexP_lock(tx_lock);
+    while (len > 0) {
+        uint32_t head = tx_head;
+        uint32_t room = MICROPY_HW_CONSOLE_TX_SIZE - (head - tx_tail);
+        // a cooked newline goes in as "\r\n", in one go
+        if (room < ((cooked && *str == '\n') ? 2 : 1)) {
+            if (tx_policy == CONSOLE_TX_DROP) {
+                tx_dropped += len;
+                break;
+            }
+            SemaphoreP_post(tx_ready);
+            SemaphoreP_pend(tx_space, CONSOLE_TX_WAIT);
+            if (tx_direct) {
+                break;
+            }
+            continue;
+        }
+
+        // copy up to the next newline, or as much as fits
+        const char *nl = cooked ? memchr(str, '\n', len) : NULL;
+        size_t run = nl ? (size_t)(nl - str) : len;
+        if (run > room) {
+            run = room;
+        }
+        if (run > 0) {
+            copy_in(head, str, run);
+            head += run;
+            str += run;
+            len -= run;
+        } else {
+            copy_in(head, "\r\n", 2);
+            head += 2;
+            str++;
+            len--;
+        }
+
+        // the data must land before the drain task can see it
+        __sync_synchronize();
+        tx_head = head;
+    }
+    MutexP_unlock(tx_lock, key);
+
+    if (!tx_direct) {
+        SemaphoreP_post(tx_ready);
+        if (line && BIOS_getThreadType() == BIOS_ThreadType_Task) {
+            Task_yield();
+        }
+    } else if (len > 0) {
+        write_direct(str, len, cooked);
+    }
+}
+
+void console_tx_flush(void) {
+    while (!tx_direct && tx_tail != tx_head) {
+        SemaphoreP_post(tx_ready);
+        SemaphoreP_pend(tx_space, CONSOLE_TX_WAIT);
+    }
+}
+
+void console_tx_panic(void) {
+    if (tx_direct) {
+        return;
+    }
+    tx_direct = true;
+    // if the drain task was part way through a chunk it is written twice
+    while (drain_chunk()) {
+    }
+}
+
+void console_tx_set_channels(uint32_t channels) {
+    channels &= CONSOLE_TX_USB | CONSOLE_TX_UART;
+    if (tx_direct || channels == tx_channels) {
+        tx_channels = channels;
+        return;
+    }
+
+    // the drain task reads the mask as it writes, so what was queued
+    // under the old one has to go out first; holding the lock keeps
+    // anything new from being queued in between
+    uintptr_t key = MutexP_lock(tx_lock);
+    console_tx_flush();
+    tx_channels = channels;
+    MutexP_unlock(tx_lock, key);
+}
+
+uint32_t console_tx_channels(void) {
+    return tx_channels;
+}
+
+void console_tx_set_overflow(uint32_t policy) {
+    tx_policy = policy;
+}
+
+uint32_t console_tx_overflow(void) {
+    return tx_policy;
+}
+
+uint32_t console_tx_dropped(void) {
+    return tx_dropped;
+}
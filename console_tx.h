@@ -0,0 +1,59 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CONSOLE_TX_INCLUDE_H
+#define CONSOLE_TX_INCLUDE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ti/drivers/UART.h>
+
+// Console output is queued in a ring buffer and written to the USB CDC
+// and UART REPL channels by a task of its own, so print() costs a copy
+// rather than the wire time.
+
+#ifndef MICROPY_HW_CONSOLE_TX_SIZE
+#define MICROPY_HW_CONSOLE_TX_SIZE  (4096)   // must be a power of two
+#endif
+
+#define CONSOLE_TX_USB      (1)
+#define CONSOLE_TX_UART     (2)
+
+// what a write does when the buffer is full
+#define CONSOLE_TX_BLOCK    (0)     // wait for room
+#define CONSOLE_TX_DROP     (1)     // throw away what doesn't fit
+
+// Sets the UART REPL channel; output is written straight to it until
+// console_tx_start().
+extern void console_tx_init(UART_Handle uart);
+
+// Adds the USB channel, a CDCD_Handle or NULL, and starts the drain task.
+extern void console_tx_start(void *cdc);
+
+// Queues len bytes, turning "\n" into "\r\n" if cooked.
+extern void console_tx_write(const char *str, size_t len, bool cooked);
+
+// Waits until everything queued has been written out.
+extern void console_tx_flush(void);
+
+// Stops queueing and writes whatever is still in the buffer from the
+// calling task, for fatal errors where the drain task may never run.
+extern void console_tx_panic(void);
+
+// Sets which channels output goes to, once whatever is already queued
+// has been written out to the ones it was queued for.
+extern void console_tx_set_channels(uint32_t channels);
+
+extern uint32_t console_tx_channels(void);
+extern void console_tx_set_overflow(uint32_t policy);
+extern uint32_t console_tx_overflow(void);
+extern uint32_t console_tx_dropped(void);
+
+#endif
@@ -142,6 +142,23 @@ bool_t ginputGetToggleStatus(uint16_t instance, GEventToggle *ptoggle) {
 	return TRUE;
 }
 
+/* Stop polling while the system sleeps */
+void ginputToggleSuspend(bool_t suspend) {
+	static bool_t suspended;
+
+	if (suspend) {
+		if (gtimerIsActive(&ToggleTimer)) {
+			gtimerStop(&ToggleTimer);
+			suspended = TRUE;
+		}
+	} else if (suspended) {
+		suspended = FALSE;
+		gtimerStart(&ToggleTimer, TogglePoll, 0, TRUE, GINPUT_TOGGLE_POLL_PERIOD);
+		// pick up anything that changed while stopped
+		gtimerJab(&ToggleTimer);
+	}
+}
+
 /* Wake up the mouse driver from an interrupt service routine (there may be new readings available) */
 void ginputToggleWakeup(void) {
 	gtimerJab(&ToggleTimer);
@@ -90,6 +90,15 @@ extern "C" {
 	 */
 	bool_t ginputGetToggleStatus(uint16_t instance, GEventToggle *ptoggle);
 
+	/**
+	 * @brief	Stop or restart polling of the toggle inputs
+	 * @details	Lets the system sleep without the poll timer waking it.
+	 *			Polling only restarts if it was running when suspended.
+	 *
+	 * @param[in] suspend	TRUE to stop polling, FALSE to restart it
+	 */
+	void ginputToggleSuspend(bool_t suspend);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,9 +40,11 @@ typedef pthread_mutex_t		gfxMutex;
 #define THREAD_RETURN(retval)					return retval
 
 #define gfxExit()						exit(0)
+#ifndef gfxAlloc
 #define gfxAlloc(sz)					malloc(sz)
 #define gfxRealloc(p,osz,nsz)			realloc(p, nsz)
 #define gfxFree(ptr)					free(ptr)
+#endif
 #define gfxMillisecondsToTicks(ms)		(ms)
 #define gfxThreadMe()					pthread_self()
 #define gfxThreadClose(th)				(void)th
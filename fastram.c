@@ -0,0 +1,52 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "py/runtime.h"
+#include "py/pystack.h"
+
+#include "fastram.h"
+
+// The GC heap is in EPI SDRAM, which runs at half the core clock.  The gc
+// in this MicroPython can only manage one contiguous heap, so rather than
+// splitting it the hottest VM data is moved out of it: with the pystack
+// enabled, code states, locals and the value stack of every call go here
+// instead of onto the GC heap.  The GC still scans the live part of the
+// pystack as a root.
+
+#if MICROPY_ENABLE_PYSTACK
+__attribute__((section(".bss.fastram"), aligned(8)))
+static mp_obj_t pystack[MICROPY_HW_PYSTACK_SIZE / sizeof(mp_obj_t)];
+#endif
+
+__attribute__((section(".bss.fastram"), aligned(8)))
+static uint8_t arena[MICROPY_HW_FASTRAM_SIZE];
+static size_t arena_used;
+
+void fastram_init0(void) {
+    #if MICROPY_ENABLE_PYSTACK
+    mp_pystack_init(pystack, pystack + MP_ARRAY_SIZE(pystack));
+    #endif
+    arena_used = 0;
+}
+
+void *fastram_alloc(size_t size) {
+    size = (size + 7) & ~7;
+    if (size > sizeof(arena) - arena_used) {
+        return NULL;
+    }
+    void *ptr = arena + arena_used;
+    arena_used += size;
+    return ptr;
+}
+
+size_t fastram_used(void) {
+    return arena_used;
+}
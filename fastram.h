@@ -0,0 +1,39 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FASTRAM_INCLUDE_H
+#define FASTRAM_INCLUDE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Internal SRAM set aside for MicroPython next to the SDRAM GC heap.  The
+// pystack (every Python call frame) lives here, plus a small arena handed
+// out through machine.fastram() for hot buffers.  The pystack size bounds
+// how deep Python can recurse, usually well before the C stack does.
+
+#ifndef MICROPY_HW_PYSTACK_SIZE
+#define MICROPY_HW_PYSTACK_SIZE     (8 * 1024)
+#endif
+
+#ifndef MICROPY_HW_FASTRAM_SIZE
+#define MICROPY_HW_FASTRAM_SIZE     (16 * 1024)
+#endif
+
+// Sets up the pystack and empties the arena; call on every soft reset,
+// after gc_init.
+extern void fastram_init0(void);
+
+// Returns size bytes of word aligned SRAM, or NULL if the arena is full.
+// Memory is only given back by the next soft reset and is not scanned by
+// the GC, so it must not hold object references.
+extern void *fastram_alloc(size_t size);
+
+extern size_t fastram_used(void);
+
+#endif
@@ -0,0 +1,487 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// Log-structured block layer for the SPI NOR flash.
+//
+// FAT blocks are never rewritten in place.  Each 4k erase sector holds a
+// header page and FTL_SLOTS data pages; a write programs the block into
+// the next free page of the sector being filled and then records its
+// block number in that sector's header.  The newest copy of a block wins:
+// sectors are ordered by the sequence number they were opened with, and
+// pages within a sector by position.
+//
+//     header   magic, erase count, seq, ~seq, { block, ~block } x FTL_SLOTS
+//
+// Everything is programmed in an order that leaves the previous state
+// readable if power goes at any point: a page only counts once its header
+// entry is complete, a sector only once its seq and ~seq agree, and an
+// erased sector gets its magic and erase count back straight away.  A
+// torn write just costs a page.
+//
+// When free sectors run low the used sector with the fewest live pages is
+// collected: its live pages are appended again and it is erased.  New
+// sectors are taken least-worn first, and a sector holding cold data is
+// collected anyway once it falls FTL_WEAR_DELTA erases behind, so wear
+// spreads over the whole region.
+//
+// FTL_SPARE_SECTORS are held back from the block count so collection
+// always finds some dead pages.  The mapping is kept in RAM and rebuilt
+// from the headers at mount.
+//
+// A volume can be made around sectors that still hold an old FAT volume
+// (ftl_format_around), which are left alone until ftl_release_held().  As
+// long as the old boot sector keeps its 0x55aa signature the old volume is
+// the one that counts and ftl_mount() reports it; release clears the
+// signature first, so a reset either side of it leaves one whole volume.
+//
+// Only the NVS API is used, so the same code builds on a host against
+// host/nvs_ram.c.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_ftl.h"
+
+#define FTL_MAGIC           (0x314c5446) // "FTL1"
+#define FTL_SLOTS           (FTL_SECTOR_SIZE / FTL_BLOCK_SIZE - 1)
+#ifndef FTL_SPARE_SECTORS
+#define FTL_SPARE_SECTORS   (24)
+#endif
+#define FTL_GC_RESERVE      (3)
+#define FTL_WEAR_DELTA      (64)
+#define FTL_UNMAPPED        (0xffff)
+
+typedef struct _ftl_entry_t {
+    uint16_t block;
+    uint16_t block_inv;
+} ftl_entry_t;
+
+typedef struct _ftl_header_t {
+    uint32_t magic;
+    uint32_t erase_count;
+    uint32_t seq;
+    uint32_t seq_inv;
+    ftl_entry_t entry[FTL_SLOTS];
+} ftl_header_t;
+
+enum { SECTOR_FREE, SECTOR_USED, SECTOR_DIRTY, SECTOR_HELD };
+
+static struct {
+    NVS_Handle nvs;
+    uint32_t num_sectors;
+    uint32_t num_blocks;
+    uint32_t next_seq;
+    int32_t active;         // sector being filled, or -1
+    uint32_t active_slot;   // next page to program in it
+    uint32_t free_count;    // sectors that are SECTOR_FREE or SECTOR_DIRTY
+    uint32_t held_count;
+    uint32_t writes;
+    uint32_t moves;
+    uint32_t erases;
+    uint16_t map[FTL_MAX_SECTORS * FTL_SLOTS];
+    uint32_t erase_count[FTL_MAX_SECTORS];
+    uint32_t seq[FTL_MAX_SECTORS];
+    uint8_t state[FTL_MAX_SECTORS];
+    uint8_t live[FTL_MAX_SECTORS];
+} ftl;
+
+static uint8_t ftl_buf[FTL_BLOCK_SIZE];
+
+static uint32_t sector_addr(uint32_t s) {
+    return s * FTL_SECTOR_SIZE;
+}
+
+static uint32_t page_addr(uint32_t page) {
+    return sector_addr(page / FTL_SLOTS) + (page % FTL_SLOTS + 1) * FTL_BLOCK_SIZE;
+}
+
+static bool nvs_read(uint32_t addr, void *buf, size_t len) {
+    return NVS_read(ftl.nvs, addr, buf, len) == NVS_STATUS_SUCCESS;
+}
+
+static bool nvs_program(uint32_t addr, const void *buf, size_t len) {
+    return NVS_write(ftl.nvs, addr, (void *)buf, len, NVS_WRITE_POST_VERIFY) == NVS_STATUS_SUCCESS;
+}
+
+// Erases a sector and marks it free, keeping its erase count.
+static bool sector_reset(uint32_t s) {
+    ftl.state[s] = SECTOR_DIRTY;
+    if (NVS_erase(ftl.nvs, sector_addr(s), FTL_SECTOR_SIZE) != NVS_STATUS_SUCCESS) {
+        return false;
+    }
+    ftl.erases++;
+    // the magic goes last so a torn count is never believed
+    uint32_t magic = FTL_MAGIC;
+    ftl.erase_count[s]++;
+    if (!nvs_program(sector_addr(s) + offsetof(ftl_header_t, erase_count), &ftl.erase_count[s], 4)
+        || !nvs_program(sector_addr(s), &magic, 4)) {
+        return false;
+    }
+    ftl.state[s] = SECTOR_FREE;
+    return true;
+}
+
+// Starts filling the least worn free sector.
+static bool sector_open(void) {
+    int32_t best = -1;
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if ((ftl.state[s] == SECTOR_FREE || ftl.state[s] == SECTOR_DIRTY)
+            && (best < 0 || ftl.erase_count[s] < ftl.erase_count[best])) {
+            best = s;
+        }
+    }
+    if (best < 0 || (ftl.state[best] == SECTOR_DIRTY && !sector_reset(best))) {
+        return false;
+    }
+
+    uint32_t seq[2] = { ftl.next_seq, ~ftl.next_seq };
+    if (!nvs_program(sector_addr(best) + offsetof(ftl_header_t, seq), seq, sizeof(seq))) {
+        ftl.state[best] = SECTOR_DIRTY;
+        return false;
+    }
+    ftl.seq[best] = ftl.next_seq++;
+    ftl.state[best] = SECTOR_USED;
+    ftl.live[best] = 0;
+    ftl.free_count--;
+    ftl.active = best;
+    ftl.active_slot = 0;
+    return true;
+}
+
+static bool ftl_append(uint32_t block, const uint8_t *src) {
+    if (ftl.active < 0 || ftl.active_slot == FTL_SLOTS) {
+        if (!sector_open()) {
+            return false;
+        }
+    }
+
+    uint32_t s = ftl.active;
+    uint32_t slot = ftl.active_slot++;
+    uint32_t page = s * FTL_SLOTS + slot;
+    if (!nvs_program(page_addr(page), src, FTL_BLOCK_SIZE)) {
+        return false;
+    }
+    ftl_entry_t entry = { block, ~block };
+    if (!nvs_program(sector_addr(s) + offsetof(ftl_header_t, entry[slot]), &entry, sizeof(entry))) {
+        return false;
+    }
+
+    uint16_t old = ftl.map[block];
+    if (old != FTL_UNMAPPED) {
+        ftl.live[old / FTL_SLOTS]--;
+    }
+    ftl.map[block] = page;
+    ftl.live[s]++;
+    return true;
+}
+
+static bool entry_valid(const ftl_entry_t *entry) {
+    return (uint16_t)(entry->block ^ entry->block_inv) == 0xffff && entry->block < ftl.num_blocks;
+}
+
+// Pages that can be programmed without erasing anything.
+static uint32_t ftl_room(void) {
+    uint32_t room = ftl.free_count * FTL_SLOTS;
+    if (ftl.active >= 0) {
+        room += FTL_SLOTS - ftl.active_slot;
+    }
+    return room;
+}
+
+// Frees one sector by moving its live pages to the end of the log.  Only
+// a sector whose pages fit in the room left is taken, so a reset part way
+// through can't leave the flash with nothing to collect into.
+static bool ftl_collect(void) {
+    uint32_t room = ftl_room();
+    int32_t victim = -1;
+    int32_t coldest = -1;
+    uint32_t max_erase = 0;
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (ftl.erase_count[s] > max_erase) {
+            max_erase = ftl.erase_count[s];
+        }
+        if (ftl.state[s] != SECTOR_USED || (int32_t)s == ftl.active || ftl.live[s] > room) {
+            continue;
+        }
+        if (victim < 0 || ftl.live[s] < ftl.live[victim]) {
+            victim = s;
+        }
+        if (coldest < 0 || ftl.erase_count[s] < ftl.erase_count[coldest]) {
+            coldest = s;
+        }
+    }
+    // wear levelling gains no space, so it waits until there is some
+    if (coldest >= 0 && ftl.erase_count[coldest] + FTL_WEAR_DELTA < max_erase
+        && ftl.free_count + 1 >= FTL_GC_RESERVE) {
+        victim = coldest;
+    } else if (victim < 0 || ftl.live[victim] == FTL_SLOTS) {
+        return false;
+    }
+
+    ftl_header_t hdr;
+    if (!nvs_read(sector_addr(victim), &hdr, sizeof(hdr))) {
+        return false;
+    }
+    for (uint32_t slot = 0; slot < FTL_SLOTS; slot++) {
+        uint32_t page = victim * FTL_SLOTS + slot;
+        if (!entry_valid(&hdr.entry[slot]) || ftl.map[hdr.entry[slot].block] != page) {
+            continue;
+        }
+        if (!nvs_read(page_addr(page), ftl_buf, FTL_BLOCK_SIZE)
+            || !ftl_append(hdr.entry[slot].block, ftl_buf)) {
+            return false;
+        }
+        ftl.moves++;
+    }
+
+    if (!sector_reset(victim)) {
+        return false;
+    }
+    ftl.free_count++;
+    return true;
+}
+
+static int compare_seq(const void *a, const void *b) {
+    uint32_t sa = ftl.seq[*(const uint16_t *)a];
+    uint32_t sb = ftl.seq[*(const uint16_t *)b];
+    return sa < sb ? -1 : sa > sb;
+}
+
+static bool page_erased(uint32_t page) {
+    if (!nvs_read(page_addr(page), ftl_buf, FTL_BLOCK_SIZE)) {
+        return false;
+    }
+    for (size_t i = 0; i < FTL_BLOCK_SIZE; i++) {
+        if (ftl_buf[i] != 0xff) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ftl_mount(NVS_Handle nvs) {
+    NVS_Attrs attrs;
+    NVS_getAttrs(nvs, &attrs);
+    if (attrs.sectorSize != FTL_SECTOR_SIZE || attrs.regionSize < (FTL_SPARE_SECTORS + 2) * FTL_SECTOR_SIZE) {
+        return FTL_MOUNT_ERROR;
+    }
+
+    ftl.nvs = nvs;
+    ftl.num_sectors = attrs.regionSize / FTL_SECTOR_SIZE;
+    if (ftl.num_sectors > FTL_MAX_SECTORS) {
+        ftl.num_sectors = FTL_MAX_SECTORS;
+    }
+    ftl.num_blocks = (ftl.num_sectors - FTL_SPARE_SECTORS) * FTL_SLOTS;
+    ftl.next_seq = 1;
+    ftl.active = -1;
+    ftl.free_count = 0;
+    ftl.held_count = 0;
+    memset(ftl.map, 0xff, sizeof(ftl.map));
+    memset(ftl.live, 0, sizeof(ftl.live));
+
+    // sort the sectors out from their headers
+    static uint16_t order[FTL_MAX_SECTORS];
+    uint32_t num_used = 0;
+    uint32_t num_known = 0;
+    uint64_t wear = 0;
+    ftl_header_t hdr;
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (!nvs_read(sector_addr(s), &hdr, sizeof(hdr))) {
+            return FTL_MOUNT_ERROR;
+        }
+        ftl.erase_count[s] = 0;
+        if (hdr.magic != FTL_MAGIC) {
+            ftl.state[s] = SECTOR_DIRTY;
+            ftl.free_count++;
+            continue;
+        }
+        ftl.erase_count[s] = hdr.erase_count;
+        wear += hdr.erase_count;
+        num_known++;
+        if (hdr.seq == 0xffffffff && hdr.seq_inv == 0xffffffff) {
+            ftl.state[s] = SECTOR_FREE;
+            ftl.free_count++;
+        } else if ((hdr.seq ^ hdr.seq_inv) == 0xffffffff) {
+            ftl.state[s] = SECTOR_USED;
+            ftl.seq[s] = hdr.seq;
+            order[num_used++] = s;
+        } else {
+            ftl.state[s] = SECTOR_DIRTY;
+            ftl.free_count++;
+        }
+    }
+
+    // sectors whose count was lost to a reset get the average
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (ftl.state[s] == SECTOR_DIRTY && num_known > 0) {
+            ftl.erase_count[s] = wear / num_known;
+        }
+    }
+
+    // an old FAT volume starts with its boot sector at address 0, and
+    // still counts if a new volume was being made around it
+    if (!nvs_read(0, &hdr.magic, 4)) {
+        return FTL_MOUNT_ERROR;
+    }
+    if (hdr.magic != FTL_MAGIC) {
+        uint8_t sig[2];
+        if (!nvs_read(510, sig, 2)) {
+            return FTL_MOUNT_ERROR;
+        }
+        if (sig[0] == 0x55 && sig[1] == 0xaa) {
+            return FTL_MOUNT_LEGACY;
+        }
+    }
+
+    if (num_known == 0) {
+        return ftl_format() ? FTL_MOUNT_BLANK : FTL_MOUNT_ERROR;
+    }
+
+    // replay the log, oldest sector first
+    qsort(order, num_used, sizeof(order[0]), compare_seq);
+    for (uint32_t i = 0; i < num_used; i++) {
+        uint32_t s = order[i];
+        if (!nvs_read(sector_addr(s), &hdr, sizeof(hdr))) {
+            return FTL_MOUNT_ERROR;
+        }
+        for (uint32_t slot = 0; slot < FTL_SLOTS; slot++) {
+            if (entry_valid(&hdr.entry[slot])) {
+                ftl.map[hdr.entry[slot].block] = s * FTL_SLOTS + slot;
+            }
+        }
+    }
+    for (uint32_t block = 0; block < ftl.num_blocks; block++) {
+        if (ftl.map[block] != FTL_UNMAPPED) {
+            ftl.live[ftl.map[block] / FTL_SLOTS]++;
+        }
+    }
+
+    // carry on filling the newest sector, past anything a reset left
+    // half written
+    if (num_used > 0) {
+        uint32_t s = order[num_used - 1];
+        ftl.active = s;
+        ftl.next_seq = ftl.seq[s] + 1;
+        ftl.active_slot = 0;
+        for (uint32_t slot = 0; slot < FTL_SLOTS; slot++) {
+            if (hdr.entry[slot].block != 0xffff || hdr.entry[slot].block_inv != 0xffff) {
+                ftl.active_slot = slot + 1;
+            }
+        }
+        while (ftl.active_slot < FTL_SLOTS && !page_erased(s * FTL_SLOTS + ftl.active_slot)) {
+            ftl.active_slot++;
+        }
+    }
+
+    return FTL_MOUNT_OK;
+}
+
+// Starts an empty volume.  Sectors holding data are erased so none of it
+// comes back at the next mount; sector 0 always is, so an old FAT volume
+// is no longer recognised.
+bool ftl_format(void) {
+    return ftl_format_around(NULL);
+}
+
+// Starts an empty volume in the sectors not set in the held bitmap, which
+// are left exactly as they are.
+bool ftl_format_around(const uint8_t *held) {
+    ftl.held_count = 0;
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (held != NULL && (held[s / 8] & (1 << (s % 8)))) {
+            ftl.state[s] = SECTOR_HELD;
+            ftl.held_count++;
+        } else if (ftl.state[s] == SECTOR_USED || ftl.state[s] == SECTOR_HELD || s == 0) {
+            if (!sector_reset(s)) {
+                return false;
+            }
+        }
+    }
+    ftl.next_seq = 1;
+    ftl.active = -1;
+    ftl.free_count = ftl.num_sectors - ftl.held_count;
+    memset(ftl.map, 0xff, sizeof(ftl.map));
+    memset(ftl.live, 0, sizeof(ftl.live));
+    return true;
+}
+
+// Makes the volume built by ftl_format_around() the one that counts and
+// hands the held sectors over to it.
+bool ftl_release_held(void) {
+    if (ftl.held_count == 0) {
+        return true;
+    }
+    // the old volume stops being recognised with this one program
+    uint8_t sig[2] = { 0, 0 };
+    if (!nvs_program(510, sig, 2)) {
+        return false;
+    }
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (ftl.state[s] == SECTOR_HELD) {
+            ftl.state[s] = SECTOR_DIRTY;
+            ftl.free_count++;
+        }
+    }
+    ftl.held_count = 0;
+    return true;
+}
+
+uint32_t ftl_block_count(void) {
+    return ftl.num_blocks;
+}
+
+bool ftl_read(uint8_t *dest, uint32_t block) {
+    if (block >= ftl.num_blocks) {
+        return false;
+    }
+    uint16_t page = ftl.map[block];
+    if (page == FTL_UNMAPPED) {
+        memset(dest, 0, FTL_BLOCK_SIZE);
+        return true;
+    }
+    return nvs_read(page_addr(page), dest, FTL_BLOCK_SIZE);
+}
+
+// Blocks that can be written before collection must start finding space.
+uint32_t ftl_room_blocks(void) {
+    uint32_t room = ftl_room();
+    return room > FTL_GC_RESERVE * FTL_SLOTS ? room - FTL_GC_RESERVE * FTL_SLOTS : 0;
+}
+
+bool ftl_write(const uint8_t *src, uint32_t block) {
+    if (block >= ftl.num_blocks) {
+        return false;
+    }
+    while (ftl.free_count < FTL_GC_RESERVE && ftl_collect()) {
+    }
+    // the last free sector is kept for collection
+    if (ftl_room() <= FTL_SLOTS) {
+        return false;
+    }
+    ftl.writes++;
+    return ftl_append(block, src);
+}
+
+void ftl_get_stats(ftl_stats_t *stats) {
+    stats->writes = ftl.writes;
+    stats->moves = ftl.moves;
+    stats->erases = ftl.erases;
+    stats->free_sectors = ftl.free_count;
+    stats->held_sectors = ftl.held_count;
+    stats->min_erase = UINT32_MAX;
+    stats->max_erase = 0;
+    for (uint32_t s = 0; s < ftl.num_sectors; s++) {
+        if (ftl.erase_count[s] < stats->min_erase) {
+            stats->min_erase = ftl.erase_count[s];
+        }
+        if (ftl.erase_count[s] > stats->max_erase) {
+            stats->max_erase = ftl.erase_count[s];
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef MICROPY_INCLUDED_TI_FLASH_FTL_H
+#define MICROPY_INCLUDED_TI_FLASH_FTL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ti/drivers/NVS.h>
+
+#define FTL_BLOCK_SIZE      (512)
+#define FTL_SECTOR_SIZE     (4096)
+#define FTL_MAX_SECTORS     (256)
+
+// results of ftl_mount()
+enum {
+    FTL_MOUNT_OK,       // an existing volume
+    FTL_MOUNT_BLANK,    // nothing on the flash; formatted as an empty volume
+    FTL_MOUNT_LEGACY,   // a FAT volume written straight to the flash, which
+                        // may have a new volume part built around it
+    FTL_MOUNT_ERROR,
+};
+
+typedef struct _ftl_stats_t {
+    uint32_t writes;        // blocks written by the caller
+    uint32_t moves;         // blocks copied by garbage collection
+    uint32_t erases;
+    uint32_t free_sectors;
+    uint32_t held_sectors;
+    uint32_t min_erase;
+    uint32_t max_erase;
+} ftl_stats_t;
+
+int ftl_mount(NVS_Handle nvs);
+bool ftl_format(void);
+bool ftl_format_around(const uint8_t *held);
+bool ftl_release_held(void);
+uint32_t ftl_room_blocks(void);
+uint32_t ftl_block_count(void);
+bool ftl_read(uint8_t *dest, uint32_t block);
+bool ftl_write(const uint8_t *src, uint32_t block);
+void ftl_get_stats(ftl_stats_t *stats);
+
+#endif // MICROPY_INCLUDED_TI_FLASH_FTL_H
@@ -0,0 +1,44 @@
+#!/usr/bin/env python
+"""Report the size of each frozen module, as a proxy for the heap it saves
+
+A module imported from the filesystem has its bytecode, constant tables and
+qstrs built on the heap (after a lexer/parser peak roughly proportional to
+the source size). Frozen bytecode is used in place from internal flash. The
+.mpy size produced by mpy-cross is reported as a rough proxy for the heap
+saved; it is not a measurement (compare gc.mem_free() on the badge for that).
+"""
+
+from __future__ import print_function
+
+import os
+import sys
+
+
+def report(mpy_dir, src_dir=None):
+    rows = []
+    for root, _, files in os.walk(mpy_dir):
+        for name in files:
+            if not name.endswith(".mpy"):
+                continue
+            path = os.path.join(root, name)
+            mod = os.path.relpath(path, mpy_dir)[:-4]
+            src = 0
+            if src_dir:
+                src_path = os.path.join(src_dir, mod + ".py")
+                if os.path.exists(src_path):
+                    src = os.path.getsize(src_path)
+            rows.append((mod, src, os.path.getsize(path)))
+
+    rows.sort(key=lambda r: -r[2])
+    print("{:<24} {:>10} {:>12}".format("module", "source", "mpy (~heap)"))
+    for mod, src, mpy in rows:
+        print("{:<24} {:>10} {:>12}".format(mod, src or "-", mpy))
+    print("{:<24} {:>10} {:>12}".format(
+        "total", sum(r[1] for r in rows), sum(r[2] for r in rows)))
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("usage: frozen_report.py <frozen_mpy dir> [<source dir>]")
+        sys.exit(1)
+    report(sys.argv[1], sys.argv[2] if len(sys.argv) > 2 else None)
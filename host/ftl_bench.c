@@ -0,0 +1,268 @@
+// Exercises flash_ftl.c against the RAM flash in nvs_ram.c: random writes
+// checked against a shadow copy, wear figures, remounting, resets at
+// random points in the middle of writes, and moving off an old volume.
+//
+//     cc -O2 -I host -I . -o ftl_bench host/ftl_bench.c host/nvs_ram.c flash_ftl.c
+//     ./ftl_bench [writes]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs_ram.h"
+#include "flash_ftl.h"
+
+#define REGION_SIZE (0x100000)
+#define SECTOR_SIZE (4096)
+
+static uint8_t *shadow;
+static uint32_t num_blocks;
+static uint32_t span;
+
+static void fill(uint8_t *buf, uint32_t block, uint32_t gen) {
+    for (int i = 0; i < FTL_BLOCK_SIZE; i += 4) {
+        uint32_t v = block * 2654435761u ^ gen * 40503u ^ i;
+        memcpy(buf + i, &v, 4);
+    }
+}
+
+// FAT-like traffic: a quarter of the writes go to a few hot blocks, the
+// rest anywhere in the first span blocks
+static uint32_t pick_block(void) {
+    if (rand() % 4 == 0) {
+        return rand() % 32;
+    }
+    return rand() % span;
+}
+
+static int verify(const char *what, uint32_t skip) {
+    uint8_t buf[FTL_BLOCK_SIZE];
+    for (uint32_t b = 0; b < num_blocks; b++) {
+        if (b == skip) {
+            continue;
+        }
+        if (!ftl_read(buf, b) || memcmp(buf, shadow + b * FTL_BLOCK_SIZE, FTL_BLOCK_SIZE) != 0) {
+            printf("FAIL %s: block %u\n", what, b);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// A new volume built around the sectors of an old one, with resets while
+// it is filled and while it takes over: until ftl_release_held() the old
+// volume must mount as before and be untouched, afterwards the new one.
+static int bench_migrate(long writes) {
+    NVS_Handle nvs = nvs_ram_open(REGION_SIZE, SECTOR_SIZE);
+    uint8_t *mem = nvs_ram_mem(nvs);
+    for (size_t i = 0; i < REGION_SIZE; i++) {
+        mem[i] = rand();
+    }
+    mem[510] = 0x55;
+    mem[511] = 0xaa;
+    uint8_t *old = malloc(REGION_SIZE);
+    memcpy(old, mem, REGION_SIZE);
+
+    // the old volume's data is in sector 0 and every third one after
+    uint8_t held[FTL_MAX_SECTORS / 8] = { 0 };
+    uint32_t num_held = 0;
+    for (uint32_t s = 0; s < REGION_SIZE / SECTOR_SIZE; s += 3) {
+        held[s / 8] |= 1 << (s % 8);
+        num_held++;
+    }
+
+    int resets = 0;
+    int tries = 0;
+    volatile int releasing = 0;
+    for (;;) {
+        int mounted = ftl_mount(nvs);
+        if (mounted == FTL_MOUNT_OK && releasing) {
+            break;
+        }
+        if (mounted != FTL_MOUNT_LEGACY) {
+            printf("FAIL migrate: old volume not recognised\n");
+            return 0;
+        }
+        for (uint32_t s = 0; s < REGION_SIZE / SECTOR_SIZE; s++) {
+            if ((held[s / 8] & (1 << (s % 8)))
+                && memcmp(mem + s * SECTOR_SIZE, old + s * SECTOR_SIZE, SECTOR_SIZE) != 0
+                && !(s == 0 && releasing)) {
+                printf("FAIL migrate: held sector %u changed\n", s);
+                return 0;
+            }
+        }
+
+        // start the copy again from scratch, as the firmware does
+        tries++;
+        releasing = 0;
+        nvs_ram_fail_after(resets < 100 ? rand() % 400 : -1);
+        if (setjmp(nvs_ram_power_fail) != 0) {
+            resets++;
+            continue;
+        }
+        if (!ftl_format_around(held)) {
+            printf("FAIL migrate: format\n");
+            return 0;
+        }
+        span = ftl_room_blocks() / 2;
+        memset(shadow, 0, num_blocks * FTL_BLOCK_SIZE);
+        uint8_t buf[FTL_BLOCK_SIZE];
+        for (long i = 0; i < writes / 10; i++) {
+            uint32_t b = rand() % span;
+            fill(buf, b, i);
+            if (!ftl_write(buf, b)) {
+                printf("FAIL migrate: write %ld\n", i);
+                return 0;
+            }
+            memcpy(shadow + b * FTL_BLOCK_SIZE, buf, FTL_BLOCK_SIZE);
+        }
+        if (!verify("migrate copy", UINT32_MAX)) {
+            return 0;
+        }
+        if (resets < 100) {
+            // as if the power went just before the release
+            nvs_ram_fail_after(-1);
+            continue;
+        }
+        // and once right in the middle of it
+        nvs_ram_fail_after(resets == 100 ? 0 : -1);
+        releasing = 1;
+        if (!ftl_release_held()) {
+            return 0;
+        }
+        nvs_ram_fail_after(-1);
+        if (ftl_mount(nvs) != FTL_MOUNT_OK) {
+            printf("FAIL migrate: not released\n");
+            return 0;
+        }
+        break;
+    }
+
+    // the new volume has taken over, and the old sectors with it
+    if (ftl_mount(nvs) != FTL_MOUNT_OK || !verify("migrate remount", UINT32_MAX)) {
+        printf("FAIL migrate: new volume\n");
+        return 0;
+    }
+    span = num_blocks;
+    uint8_t buf[FTL_BLOCK_SIZE];
+    for (long i = 0; i < writes; i++) {
+        uint32_t b = pick_block();
+        fill(buf, b, i);
+        if (!ftl_write(buf, b)) {
+            printf("FAIL migrate: write after release %ld\n", i);
+            return 0;
+        }
+        memcpy(shadow + b * FTL_BLOCK_SIZE, buf, FTL_BLOCK_SIZE);
+    }
+    if (!verify("migrate final", UINT32_MAX)) {
+        return 0;
+    }
+    printf("migrated around %u held sectors after %d resets, %d tries\n", num_held, resets, tries);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    long writes = argc > 1 ? atol(argv[1]) : 200000;
+    srand(1);
+
+    NVS_Handle nvs = nvs_ram_open(REGION_SIZE, SECTOR_SIZE);
+
+    // an old FAT volume is recognised and left alone until formatted
+    uint8_t sig[2] = { 0x55, 0xaa };
+    NVS_write(nvs, 510, sig, 2, 0);
+    if (ftl_mount(nvs) != FTL_MOUNT_LEGACY || nvs_ram_mem(nvs)[510] != 0x55 || !ftl_format()) {
+        printf("FAIL legacy\n");
+        return 1;
+    }
+    if (ftl_mount(nvs) != FTL_MOUNT_OK) {
+        printf("FAIL mount after format\n");
+        return 1;
+    }
+
+    num_blocks = ftl_block_count();
+    shadow = calloc(num_blocks, FTL_BLOCK_SIZE);
+    printf("%u blocks (%u KB)\n", num_blocks, num_blocks / 2);
+
+    // random writes over half the volume, then all of it
+    uint8_t buf[FTL_BLOCK_SIZE];
+    for (span = num_blocks / 2; span <= num_blocks; span += num_blocks / 2) {
+        ftl_stats_t st;
+        ftl_get_stats(&st);
+        unsigned long erases0 = nvs_ram_erases;
+        uint32_t moves0 = st.moves;
+        unsigned long in_place = 0;
+        uint32_t cached = UINT32_MAX;
+        for (long i = 0; i < writes; i++) {
+            uint32_t b = pick_block();
+            if (b * FTL_BLOCK_SIZE / SECTOR_SIZE != cached) {
+                cached = b * FTL_BLOCK_SIZE / SECTOR_SIZE;
+                in_place++;
+            }
+            fill(buf, b, span + i);
+            if (!ftl_write(buf, b)) {
+                printf("FAIL write %ld\n", i);
+                return 1;
+            }
+            memcpy(shadow + b * FTL_BLOCK_SIZE, buf, FTL_BLOCK_SIZE);
+        }
+        if (!verify("random writes", UINT32_MAX)) {
+            return 1;
+        }
+        ftl_get_stats(&st);
+        printf("%ld writes over %u blocks: %.3f erases per write (%.3f in place), %.2f moves per write, erase count %u..%u\n",
+            writes, span, (double)(nvs_ram_erases - erases0) / writes, (double)in_place / writes,
+            (double)(st.moves - moves0) / writes, st.min_erase, st.max_erase);
+    }
+
+    if (ftl_mount(nvs) != FTL_MOUNT_OK || !verify("remount", UINT32_MAX)) {
+        return 1;
+    }
+
+    // resets part way through a write
+    span = num_blocks;
+    int resets = 0;
+    for (long i = 0; i < 2000; i++) {
+        volatile uint32_t b = pick_block();
+        fill(buf, b, writes + i);
+        nvs_ram_fail_after(rand() % 40);
+        if (setjmp(nvs_ram_power_fail) == 0) {
+            for (int n = 0; n < 20; n++) {
+                if (!ftl_write(buf, b)) {
+                    printf("FAIL write after reset\n");
+                    return 1;
+                }
+                memcpy(shadow + b * FTL_BLOCK_SIZE, buf, FTL_BLOCK_SIZE);
+                b = pick_block();
+                fill(buf, b, writes + i * 20 + n);
+            }
+            nvs_ram_fail_after(-1);
+            continue;
+        }
+
+        // the interrupted block is either old or new, everything else intact
+        resets++;
+        if (ftl_mount(nvs) != FTL_MOUNT_OK || !verify("reset", b)) {
+            return 1;
+        }
+        uint8_t got[FTL_BLOCK_SIZE];
+        ftl_read(got, b);
+        if (memcmp(got, buf, FTL_BLOCK_SIZE) == 0) {
+            memcpy(shadow + b * FTL_BLOCK_SIZE, buf, FTL_BLOCK_SIZE);
+        } else if (memcmp(got, shadow + b * FTL_BLOCK_SIZE, FTL_BLOCK_SIZE) != 0) {
+            printf("FAIL reset: block %u torn\n", b);
+            return 1;
+        }
+    }
+    if (ftl_mount(nvs) != FTL_MOUNT_OK || !verify("final", UINT32_MAX)) {
+        return 1;
+    }
+    ftl_stats_t st;
+    ftl_get_stats(&st);
+    printf("%d resets survived, erase count %u..%u\n", resets, st.min_erase, st.max_erase);
+
+    if (!bench_migrate(writes)) {
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
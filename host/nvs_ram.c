@@ -0,0 +1,102 @@
+// NVS driver backed by RAM, behaving like NOR flash: erase sets a sector
+// to 0xff and programming can only clear bits.
+//
+// nvs_ram_fail_after(n) makes the n-th program or erase from then on stop
+// part way through and longjmp to nvs_ram_power_fail, simulating a reset.
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs_ram.h"
+
+struct NVS_Config_ {
+    uint8_t *mem;
+    size_t size;
+    size_t sector_size;
+};
+
+static struct NVS_Config_ nvs_ram;
+static long fail_countdown = -1;
+
+jmp_buf nvs_ram_power_fail;
+unsigned long nvs_ram_erases;
+unsigned long nvs_ram_programs;
+
+NVS_Handle nvs_ram_open(size_t size, size_t sector_size) {
+    nvs_ram.mem = malloc(size);
+    nvs_ram.size = size;
+    nvs_ram.sector_size = sector_size;
+    memset(nvs_ram.mem, 0xff, size);
+    return &nvs_ram;
+}
+
+uint8_t *nvs_ram_mem(NVS_Handle handle) {
+    return handle->mem;
+}
+
+void nvs_ram_fail_after(long ops) {
+    fail_countdown = ops;
+}
+
+// Returns how many bytes of an operation of len bytes get done.
+static size_t power_check(size_t len) {
+    if (fail_countdown < 0 || fail_countdown-- > 0) {
+        return len;
+    }
+    return rand() % (len + 1);
+}
+
+void NVS_getAttrs(NVS_Handle handle, NVS_Attrs *attrs) {
+    attrs->regionBase = handle->mem;
+    attrs->regionSize = handle->size;
+    attrs->sectorSize = handle->sector_size;
+}
+
+int_fast16_t NVS_read(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize) {
+    if (offset + bufferSize > handle->size) {
+        return NVS_STATUS_INV_OFFSET;
+    }
+    memcpy(buffer, handle->mem + offset, bufferSize);
+    return NVS_STATUS_SUCCESS;
+}
+
+int_fast16_t NVS_erase(NVS_Handle handle, size_t offset, size_t size) {
+    if (offset % handle->sector_size || size % handle->sector_size || offset + size > handle->size) {
+        return NVS_STATUS_INV_OFFSET;
+    }
+    size_t done = power_check(size);
+    memset(handle->mem + offset, 0xff, done);
+    if (done < size) {
+        fail_countdown = -1;
+        longjmp(nvs_ram_power_fail, 1);
+    }
+    nvs_ram_erases += size / handle->sector_size;
+    return NVS_STATUS_SUCCESS;
+}
+
+int_fast16_t NVS_write(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize, uint_fast16_t flags) {
+    if (offset + bufferSize > handle->size) {
+        return NVS_STATUS_INV_OFFSET;
+    }
+    if (flags & NVS_WRITE_ERASE) {
+        size_t start = offset - offset % handle->sector_size;
+        size_t end = offset + bufferSize;
+        end += (handle->sector_size - end % handle->sector_size) % handle->sector_size;
+        NVS_erase(handle, start, end - start);
+    }
+    const uint8_t *src = buffer;
+    size_t done = power_check(bufferSize);
+    for (size_t i = 0; i < done; i++) {
+        handle->mem[offset + i] &= src[i];
+    }
+    if (done < bufferSize) {
+        fail_countdown = -1;
+        longjmp(nvs_ram_power_fail, 1);
+    }
+    nvs_ram_programs++;
+    if ((flags & NVS_WRITE_POST_VERIFY) && memcmp(handle->mem + offset, src, bufferSize) != 0) {
+        return NVS_STATUS_ERROR;
+    }
+    return NVS_STATUS_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#ifndef HOST_NVS_RAM_H
+#define HOST_NVS_RAM_H
+
+#include <setjmp.h>
+
+#include <ti/drivers/NVS.h>
+
+extern jmp_buf nvs_ram_power_fail;
+extern unsigned long nvs_ram_erases;
+extern unsigned long nvs_ram_programs;
+
+NVS_Handle nvs_ram_open(size_t size, size_t sector_size);
+uint8_t *nvs_ram_mem(NVS_Handle handle);
+void nvs_ram_fail_after(long ops);
+
+#endif // HOST_NVS_RAM_H
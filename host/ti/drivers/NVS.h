@@ -0,0 +1,31 @@
+// The parts of the TI-RTOS NVS driver API used by flash_ftl.c, for building
+// it on a host against nvs_ram.c.
+
+#ifndef HOST_TI_DRIVERS_NVS_H
+#define HOST_TI_DRIVERS_NVS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NVS_STATUS_SUCCESS      (0)
+#define NVS_STATUS_ERROR        (-1)
+#define NVS_STATUS_INV_OFFSET   (-3)
+
+#define NVS_WRITE_ERASE         (0x1)
+#define NVS_WRITE_PRE_VERIFY    (0x2)
+#define NVS_WRITE_POST_VERIFY   (0x4)
+
+typedef struct NVS_Config_ *NVS_Handle;
+
+typedef struct {
+    void *regionBase;
+    size_t regionSize;
+    size_t sectorSize;
+} NVS_Attrs;
+
+void NVS_getAttrs(NVS_Handle handle, NVS_Attrs *attrs);
+int_fast16_t NVS_read(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize);
+int_fast16_t NVS_write(NVS_Handle handle, size_t offset, void *buffer, size_t bufferSize, uint_fast16_t flags);
+int_fast16_t NVS_erase(NVS_Handle handle, size_t offset, size_t size);
+
+#endif // HOST_TI_DRIVERS_NVS_H
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include "MSP_EXP432E401Y.h"
+
+#include "i2c_bus.h"
+
+// Owner of the internal I2C bus, which tildaThread and machine.I2C share.
+//
+// Each user takes the bus for a whole batch of transactions, so a register
+// pointer write and its read, or a run of sensor registers, can't be split
+// by the other side.  When the bus is released it is handed straight to
+// the highest priority waiter, which keeps button reads from queueing
+// behind background polling or a long python batch.
+//
+// The handle is a normal blocking one, so drivers that take an I2C_Handle
+// (OPT3001) still work as long as their calls are bracketed with
+// I2CBus_acquire/I2CBus_release.
+
+static I2C_Handle handle;
+static volatile bool opening;
+static bool busy;
+static uint32_t waiting[I2CBus_PRIORITY_COUNT];
+static Semaphore_Struct wakeStruct[I2CBus_PRIORITY_COUNT];
+static Semaphore_Handle wake[I2CBus_PRIORITY_COUNT];
+
+I2C_Handle I2CBus_open(void)
+{
+    // I2C_open allocates and sets up its Hwi, so it isn't run with the
+    // scheduler off; whoever gets here first opens, anyone else waits
+    bool opener = false;
+    UInt key = Task_disable();
+    if (handle == NULL && !opening) {
+        opening = true;
+        opener = true;
+        if (wake[0] == NULL) {
+            for (int i = 0; i < I2CBus_PRIORITY_COUNT; i++) {
+                Semaphore_construct(&wakeStruct[i], 0, NULL);
+                wake[i] = Semaphore_handle(&wakeStruct[i]);
+            }
+        }
+    }
+    Task_restore(key);
+
+    if (opener) {
+        I2C_Params params;
+        I2C_Params_init(&params);
+        params.bitRate = I2C_400kHz;
+        I2C_Handle opened = I2C_open(MSP_EXP432E401Y_I2C4, &params);
+
+        key = Task_disable();
+        handle = opened;
+        opening = false;
+        Task_restore(key);
+    }
+    else {
+        while (opening) {
+            Task_sleep(1);
+        }
+    }
+
+    return handle;
+}
+
+void I2CBus_acquire(I2CBus_Priority priority)
+{
+    UInt key = Task_disable();
+    if (!busy) {
+        busy = true;
+        Task_restore(key);
+        return;
+    }
+    waiting[priority]++;
+    Task_restore(key);
+
+    // the releasing task hands the bus over along with the post
+    Semaphore_pend(wake[priority], BIOS_WAIT_FOREVER);
+}
+
+void I2CBus_release(void)
+{
+    UInt key = Task_disable();
+    for (int i = 0; i < I2CBus_PRIORITY_COUNT; i++) {
+        if (waiting[i]) {
+            waiting[i]--;
+            Semaphore_post(wake[i]);
+            Task_restore(key);
+            return;
+        }
+    }
+    busy = false;
+    Task_restore(key);
+}
+
+// Run count transactions as one batch, filling in ok[] if it's given.
+// Returns how many succeeded.
+size_t I2CBus_transfer(I2C_Transaction *trans, size_t count, bool *ok,
+                       I2CBus_Priority priority)
+{
+    size_t succeeded = 0;
+
+    I2CBus_acquire(priority);
+    for (size_t i = 0; i < count; i++) {
+        bool status = I2C_transfer(handle, &trans[i]);
+        if (ok) {
+            ok[i] = status;
+        }
+        if (status) {
+            succeeded++;
+        }
+    }
+    I2CBus_release();
+
+    return succeeded;
+}
@@ -0,0 +1,32 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef I2C_BUS_INCLUDE_H
+#define I2C_BUS_INCLUDE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ti/drivers/I2C.h>
+
+// Waiters are served highest priority first, in order within a priority
+typedef enum I2CBus_Priority {
+    I2CBus_PRIORITY_HIGH = 0,   // button reads
+    I2CBus_PRIORITY_NORMAL,     // python
+    I2CBus_PRIORITY_LOW,        // background sensor and charger polling
+
+    I2CBus_PRIORITY_COUNT
+} I2CBus_Priority;
+
+extern I2C_Handle I2CBus_open(void);
+extern void I2CBus_acquire(I2CBus_Priority priority);
+extern void I2CBus_release(void);
+extern size_t I2CBus_transfer(I2C_Transaction *trans, size_t count, bool *ok,
+                              I2CBus_Priority priority);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// Compiled-bytecode cache for imports.
+//
+// mp_import_stat is routed through import_cache_stat().  When the import
+// machinery asks about "foo.py" we make sure a "foo.mpy" compiled from the
+// current source sits beside it and then report the .py as missing, so the
+// core falls through to loading the .mpy instead of lexing and compiling.
+//
+// Each cache file ends with a trailer holding the size and mtime of the
+// source it was built from; the .mpy loader stops reading at the end of the
+// raw code and never sees it.  A mismatch, a missing trailer or a failed
+// write just means the source is compiled as usual.  A .mpy without the
+// trailer belongs to the user and is never overwritten, and a cache file
+// whose source has gone is deleted instead of being imported.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/compile.h"
+#include "py/persistentcode.h"
+#include "py/stream.h"
+#include "py/lexer.h"
+#include "extmod/vfs.h"
+
+#if MICROPY_TI_IMPORT_CACHE
+
+#define CACHE_MAGIC         (0x4359504d) // "MPYC"
+#define CACHE_TRAILER_LEN   (12)
+
+typedef struct _cache_key_t {
+    uint32_t size;
+    uint32_t mtime;
+} cache_key_t;
+
+STATIC bool cache_source_key(const char *path, cache_key_t *key) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t stat = mp_vfs_stat(mp_obj_new_str(path, strlen(path)));
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(stat, 10, &items);
+        key->size = mp_obj_get_int_truncated(items[6]);
+        key->mtime = mp_obj_get_int_truncated(items[8]);
+        nlr_pop();
+        return true;
+    }
+    return false;
+}
+
+STATIC mp_obj_t cache_open(const char *path, const char *mode) {
+    mp_obj_t args[2] = {
+        mp_obj_new_str(path, strlen(path)),
+        mp_obj_new_str(mode, strlen(mode)),
+    };
+    return mp_vfs_open(2, args, (mp_map_t*)&mp_const_empty_map);
+}
+
+STATIC void put_le32(byte *buf, uint32_t val) {
+    buf[0] = val;
+    buf[1] = val >> 8;
+    buf[2] = val >> 16;
+    buf[3] = val >> 24;
+}
+
+STATIC uint32_t get_le32(const byte *buf) {
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+typedef enum {
+    CACHE_NONE,     // no .mpy at all
+    CACHE_USER,     // a .mpy without our trailer, which we leave alone
+    CACHE_OURS,     // a cache file; key holds the source it was built from
+} cache_state_t;
+
+STATIC cache_state_t cache_read_trailer(const char *mpy_path, cache_key_t *key) {
+    if (mp_vfs_import_stat(mpy_path) != MP_IMPORT_STAT_FILE) {
+        return CACHE_NONE;
+    }
+
+    cache_state_t state = CACHE_USER;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t f = cache_open(mpy_path, "rb");
+        const mp_stream_p_t *stream_p = mp_get_stream_raise(f, MP_STREAM_OP_READ | MP_STREAM_OP_IOCTL);
+        struct mp_stream_seek_t seek = { .offset = -CACHE_TRAILER_LEN, .whence = MP_SEEK_END };
+        int err;
+        byte trailer[CACHE_TRAILER_LEN];
+        if (stream_p->ioctl(f, MP_STREAM_SEEK, (uintptr_t)&seek, &err) != MP_STREAM_ERROR
+            && mp_stream_read_exactly(f, trailer, CACHE_TRAILER_LEN, &err) == CACHE_TRAILER_LEN
+            && get_le32(trailer) == CACHE_MAGIC) {
+            key->size = get_le32(trailer + 4);
+            key->mtime = get_le32(trailer + 8);
+            state = CACHE_OURS;
+        }
+        mp_stream_close(f);
+        nlr_pop();
+    }
+    return state;
+}
+
+typedef struct _cache_writer_t {
+    mp_obj_t file;
+    int err;
+} cache_writer_t;
+
+STATIC void cache_write_strn(void *data, const char *str, size_t len) {
+    cache_writer_t *w = data;
+    if (w->err == 0) {
+        mp_stream_write_exactly(w->file, (void*)str, len, &w->err);
+    }
+}
+
+// Compiles the source and writes it out as a cache file.  Returns false,
+// leaving no cache file behind, if anything goes wrong; the normal import
+// path will then compile the source again and report any error itself.
+STATIC bool cache_build(const char *py_path, const char *mpy_path, const cache_key_t *key) {
+    cache_writer_t w = { MP_OBJ_NULL, 0 };
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // open first so a read-only filesystem costs nothing extra
+        w.file = cache_open(mpy_path, "wb");
+
+        mp_lexer_t *lex = mp_lexer_new_from_file(py_path);
+        qstr source_name = lex->source_name;
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        mp_raw_code_t *rc = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+
+        mp_print_t print = { &w, cache_write_strn };
+        mp_raw_code_save(rc, &print);
+
+        byte trailer[CACHE_TRAILER_LEN];
+        put_le32(trailer, CACHE_MAGIC);
+        put_le32(trailer + 4, key->size);
+        put_le32(trailer + 8, key->mtime);
+        cache_write_strn(&w, (const char*)trailer, CACHE_TRAILER_LEN);
+
+        mp_stream_close(w.file);
+        nlr_pop();
+        if (w.err == 0) {
+            return true;
+        }
+    }
+
+    // clean up a partial cache file, ignoring any further errors (closing
+    // an already closed file is harmless)
+    if (w.file != MP_OBJ_NULL && nlr_push(&nlr) == 0) {
+        mp_stream_close(w.file);
+        mp_vfs_remove(mp_obj_new_str(mpy_path, strlen(mpy_path)));
+        nlr_pop();
+    }
+    return false;
+}
+
+STATIC void cache_remove(const char *mpy_path) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_vfs_remove(mp_obj_new_str(mpy_path, strlen(mpy_path)));
+        nlr_pop();
+    }
+}
+
+// A cache file whose source has been deleted is removed rather than
+// imported.
+STATIC mp_import_stat_t cache_stat_mpy(const char *path, size_t len) {
+    cache_key_t cached;
+    if (cache_read_trailer(path, &cached) != CACHE_OURS) {
+        return MP_IMPORT_STAT_FILE;
+    }
+
+    // "foo.mpy" -> "foo.py"
+    char *py_path = alloca(len);
+    memcpy(py_path, path, len - 3);
+    strcpy(py_path + len - 3, "py");
+    if (mp_vfs_import_stat(py_path) == MP_IMPORT_STAT_FILE) {
+        return MP_IMPORT_STAT_FILE;
+    }
+
+    cache_remove(path);
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+mp_import_stat_t import_cache_stat(const char *path) {
+    mp_import_stat_t stat = mp_vfs_import_stat(path);
+
+    size_t len = strlen(path);
+    if (stat != MP_IMPORT_STAT_FILE) {
+        return stat;
+    }
+    if (len >= 4 && strcmp(path + len - 4, ".mpy") == 0) {
+        return cache_stat_mpy(path, len);
+    }
+    if (len < 3 || strcmp(path + len - 3, ".py") != 0) {
+        return stat;
+    }
+
+    cache_key_t key;
+    if (!cache_source_key(path, &key)) {
+        return stat;
+    }
+
+    // "foo.py" -> "foo.mpy"
+    char *mpy_path = alloca(len + 2);
+    memcpy(mpy_path, path, len - 2);
+    strcpy(mpy_path + len - 2, "mpy");
+
+    cache_key_t cached;
+    switch (cache_read_trailer(mpy_path, &cached)) {
+        case CACHE_USER:
+            // never overwrite a .mpy we didn't write; the source wins, as
+            // it does without the cache
+            return stat;
+        case CACHE_OURS:
+            if (cached.size == key.size && cached.mtime == key.mtime) {
+                // hide the source so the importer picks up the .mpy
+                return MP_IMPORT_STAT_NO_EXIST;
+            }
+            break;
+        case CACHE_NONE:
+            break;
+    }
+
+    if (cache_build(path, mpy_path, &key)) {
+        return MP_IMPORT_STAT_NO_EXIST;
+    }
+
+    return stat;
+}
+
+#endif // MICROPY_TI_IMPORT_CACHE
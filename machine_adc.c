@@ -13,8 +13,24 @@
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/objarray.h"
+
+#include <ti/sysbios/knl/Clock.h>
 
 #include <ti/drivers/ADC.h>
+#include <ti/drivers/ADCBuf.h>
+
+// convert() takes single samples through the ADC driver.  read_timed(),
+// read_timed_multi() and stream() use the ADCBuf instance instead, which
+// samples the same pins (ADCBuf channel n is ADC(n)) on a hardware timer
+// and moves the results by uDMA, so the sample clock doesn't depend on the
+// VM at all.  ADCBuf runs on ADC1, as does ADC(1), so the single sample
+// handles are closed while it is in use and reopened by the next convert().
+//
+// A stream keeps its callback and its two blocks in machine_adc_stream[]:
+//     [0] callback, [1] and [2] the blocks as memoryview('H')
+
+#define RATE_MAX (1000000)
 
 typedef struct _machine_adc_obj_t {
     mp_obj_base_t base;
@@ -33,7 +49,11 @@ static machine_adc_obj_t adc_obj[NUM_ADC] = {
     {{&machine_adc_type}, .id = 3, .adc = NULL},
 };
 
-void machine_adc_teardown(void) {
+static ADCBuf_Handle adcbuf;
+static ADCBuf_Conversion stream_conversion;
+static volatile uint32_t stream_missed;
+
+STATIC void adc_close_single(void) {
     for (int i = 0; i < NUM_ADC; i++) {
         if (adc_obj[i].adc) {
             ADC_close(adc_obj[i].adc);
@@ -42,6 +62,91 @@ void machine_adc_teardown(void) {
     }
 }
 
+STATIC void adcbuf_close(void) {
+    if (adcbuf) {
+        ADCBuf_convertCancel(adcbuf);
+        ADCBuf_close(adcbuf);
+        adcbuf = NULL;
+    }
+    for (int i = 0; i < 3; i++) {
+        MP_STATE_PORT(machine_adc_stream)[i] = MP_OBJ_NULL;
+    }
+}
+
+void machine_adc_teardown(void) {
+    adcbuf_close();
+    adc_close_single();
+}
+
+STATIC void adcbuf_open(ADCBuf_Params *params) {
+    if (adcbuf) {
+        mp_raise_msg(&mp_type_OSError, "ADC stream running");
+    }
+    adc_close_single();
+    if ((adcbuf = ADCBuf_open(0, params)) == NULL) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+}
+
+STATIC uint32_t adc_get_rate(mp_obj_t rate_in) {
+    mp_int_t rate = mp_obj_get_int(rate_in);
+    if (rate < 1 || rate > RATE_MAX) {
+        mp_raise_ValueError("rate out of range");
+    }
+    return rate;
+}
+
+// Sample each ADC into its buffer at rate_hz, all on the same timer ticks,
+// blocking until the buffers are full.  Returns the samples per buffer.
+STATIC mp_int_t adc_read_timed(size_t n, const mp_obj_t *adcs, const mp_obj_t *bufs, mp_obj_t rate_in) {
+    uint32_t rate = adc_get_rate(rate_in);
+    ADCBuf_Conversion conv[NUM_ADC];
+    if (n < 1 || n > MP_ARRAY_SIZE(conv)) {
+        mp_raise_ValueError(NULL);
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!MP_OBJ_IS_TYPE(adcs[i], &machine_adc_type)) {
+            mp_raise_TypeError("expecting ADC");
+        }
+        machine_adc_obj_t *adc = MP_OBJ_TO_PTR(adcs[i]);
+        mp_buffer_info_t buf_info;
+        mp_get_buffer_raise(bufs[i], &buf_info, MP_BUFFER_WRITE);
+        size_t samples = buf_info.len / sizeof(uint16_t);
+        if (i > 0 && samples != count) {
+            mp_raise_ValueError("buffers must be the same length");
+        }
+        count = samples;
+        conv[i].adcChannel = adc->id;
+        conv[i].sampleBuffer = buf_info.buf;
+        conv[i].sampleBufferTwo = NULL;
+        conv[i].samplesRequestedCount = count;
+        conv[i].arg = NULL;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    ADCBuf_Params params;
+    ADCBuf_Params_init(&params);
+    params.returnMode = ADCBuf_RETURN_MODE_BLOCKING;
+    params.recurrenceMode = ADCBuf_RECURRENCE_MODE_ONE_SHOT;
+    params.samplingFrequency = rate;
+    // the run itself plus a second for slack
+    params.blockingTimeout = ((uint64_t)count * 1000000 / rate + 1000000) / Clock_tickPeriod;
+    adcbuf_open(&params);
+
+    int_fast16_t status = ADCBuf_convert(adcbuf, conv, n);
+    ADCBuf_close(adcbuf);
+    adcbuf = NULL;
+    if (status != ADCBuf_STATUS_SUCCESS) {
+        mp_raise_OSError(MP_EIO);
+    }
+
+    return count;
+}
+
 STATIC mp_obj_t machine_adc_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
     mp_int_t channel = mp_obj_get_int(args[0]);
@@ -50,7 +155,7 @@ STATIC mp_obj_t machine_adc_make_new(const mp_obj_type_t *type, size_t n_args, s
         mp_raise_OSError(MP_ENODEV);
     }
     machine_adc_obj_t *self = &adc_obj[channel];
-    if (self->adc == NULL) {
+    if (self->adc == NULL && adcbuf == NULL) {
         if ((self->adc = ADC_open(channel, NULL)) == NULL) {
             mp_raise_OSError(MP_ENODEV);
         }
@@ -66,6 +171,14 @@ STATIC void machine_adc_print(const mp_print_t *print, mp_obj_t self_in, mp_prin
 
 STATIC mp_obj_t machine_adc_convert(mp_obj_t self_in) {
     machine_adc_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (adcbuf) {
+        mp_raise_msg(&mp_type_OSError, "ADC stream running");
+    }
+    if (self->adc == NULL) {
+        if ((self->adc = ADC_open(self->id, NULL)) == NULL) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+    }
     uint16_t sample;
     if (ADC_convert(self->adc, &sample) == ADC_STATUS_ERROR) {
         mp_raise_OSError(MP_EIO);
@@ -78,8 +191,113 @@ STATIC mp_obj_t machine_adc_convert(mp_obj_t self_in) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_adc_convert_obj, machine_adc_convert);
 
+/* read_timed(buf, rate_hz) -> fill buf with 16-bit samples taken at rate_hz */
+STATIC mp_obj_t machine_adc_read_timed(mp_obj_t self_in, mp_obj_t buf_in, mp_obj_t rate_in) {
+    return MP_OBJ_NEW_SMALL_INT(adc_read_timed(1, &self_in, &buf_in, rate_in));
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_adc_read_timed_obj, machine_adc_read_timed);
+
+/* read_timed_multi((adc, ...), (buf, ...), rate_hz) -> sample several together */
+STATIC mp_obj_t machine_adc_read_timed_multi(mp_obj_t adcs_in, mp_obj_t bufs_in, mp_obj_t rate_in) {
+    size_t n_adcs, n_bufs;
+    mp_obj_t *adcs, *bufs;
+    mp_obj_get_array(adcs_in, &n_adcs, &adcs);
+    mp_obj_get_array(bufs_in, &n_bufs, &bufs);
+    if (n_adcs != n_bufs) {
+        mp_raise_ValueError("need a buffer for each ADC");
+    }
+    return MP_OBJ_NEW_SMALL_INT(adc_read_timed(n_adcs, adcs, bufs, rate_in));
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_adc_read_timed_multi_fun_obj, machine_adc_read_timed_multi);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(machine_adc_read_timed_multi_obj, MP_ROM_PTR(&machine_adc_read_timed_multi_fun_obj));
+
+// Runs in the ADCBuf interrupt as each block completes.  The callback is
+// queued with the block that just filled; the driver goes on into the
+// other one, so it has one block's worth of time to run.
+STATIC void adc_stream_callback(ADCBuf_Handle handle, ADCBuf_Conversion *conversion,
+    void *completed, uint32_t channel) {
+    mp_obj_t *stream = MP_STATE_PORT(machine_adc_stream);
+    if (stream[0] == MP_OBJ_NULL) {
+        return;
+    }
+    mp_obj_t block = completed == conversion->sampleBuffer ? stream[1] : stream[2];
+    if (!mp_sched_schedule(stream[0], block)) {
+        stream_missed++;
+    }
+}
+
+/*
+ * stream(callback, rate_hz, block=256) -> sample continuously, calling
+ * callback(samples) with each full block
+ * stream(None) -> stop, returning the number of blocks the callback missed
+ */
+STATIC mp_obj_t machine_adc_stream(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_callback, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_rate, MP_ARG_INT, {.u_int = 8000} },
+        { MP_QSTR_block, MP_ARG_INT, {.u_int = 256} },
+    };
+    enum { ARG_callback, ARG_rate, ARG_block };
+    machine_adc_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_callback].u_obj == mp_const_none) {
+        uint32_t missed = stream_missed;
+        adcbuf_close();
+        return MP_OBJ_NEW_SMALL_INT(missed);
+    }
+    if (!mp_obj_is_callable(args[ARG_callback].u_obj)) {
+        mp_raise_ValueError("callback must be callable");
+    }
+
+    uint32_t rate = adc_get_rate(MP_OBJ_NEW_SMALL_INT(args[ARG_rate].u_int));
+    mp_int_t block = args[ARG_block].u_int;
+    if (block < 1) {
+        mp_raise_ValueError("block must be positive");
+    }
+
+    // allocate before touching the hardware, a MemoryError leaves it idle
+    uint16_t *a = m_new(uint16_t, block);
+    uint16_t *b = m_new(uint16_t, block);
+    mp_obj_t *stream = MP_STATE_PORT(machine_adc_stream);
+
+    ADCBuf_Params params;
+    ADCBuf_Params_init(&params);
+    params.returnMode = ADCBuf_RETURN_MODE_CALLBACK;
+    params.recurrenceMode = ADCBuf_RECURRENCE_MODE_CONTINUOUS;
+    params.samplingFrequency = rate;
+    params.callbackFxn = adc_stream_callback;
+    adcbuf_open(&params);
+
+    stream[1] = mp_obj_new_memoryview('H', block, a);
+    stream[2] = mp_obj_new_memoryview('H', block, b);
+    stream[0] = args[ARG_callback].u_obj;
+    stream_missed = 0;
+
+    stream_conversion.adcChannel = self->id;
+    stream_conversion.sampleBuffer = a;
+    stream_conversion.sampleBufferTwo = b;
+    stream_conversion.samplesRequestedCount = block;
+    stream_conversion.arg = NULL;
+    if (ADCBuf_convert(adcbuf, &stream_conversion, 1) != ADCBuf_STATUS_SUCCESS) {
+        adcbuf_close();
+        mp_raise_OSError(MP_EIO);
+    }
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_adc_stream_obj, 2, machine_adc_stream);
+
 STATIC const mp_rom_map_elem_t machine_adc_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_convert), MP_ROM_PTR(&machine_adc_convert_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_timed), MP_ROM_PTR(&machine_adc_read_timed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_timed_multi), MP_ROM_PTR(&machine_adc_read_timed_multi_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stream), MP_ROM_PTR(&machine_adc_stream_obj) },
 #ifdef MACHINE_ADC_IDS
     MACHINE_ADC_IDS
 #endif
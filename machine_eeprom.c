@@ -26,12 +26,7 @@ typedef struct _machine_eeprom_obj_t {
 void machine_eeprom_teardown(void) {
 }
 
-STATIC mp_obj_t machine_eeprom_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    mp_arg_check_num(n_args, n_kw, 0, MP_OBJ_FUN_ARGS_MAX, true);
-    // kwargs not handled
-    machine_eeprom_obj_t *self = m_new_obj(machine_eeprom_obj_t);
-    self->base.type = type;
-
+void machine_eeprom_init(void) {
     static bool init = false;
     if (!init) {
         // TODO: should be a Power dependency
@@ -42,6 +37,15 @@ STATIC mp_obj_t machine_eeprom_make_new(const mp_obj_type_t *type, size_t n_args
         }
         init = true;
     }
+}
+
+STATIC mp_obj_t machine_eeprom_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, MP_OBJ_FUN_ARGS_MAX, true);
+    // kwargs not handled
+    machine_eeprom_obj_t *self = m_new_obj(machine_eeprom_obj_t);
+    self->base.type = type;
+
+    machine_eeprom_init();
 
     return MP_OBJ_FROM_PTR(self);
 }
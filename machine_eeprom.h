@@ -14,6 +14,7 @@
 #if MICROPY_MACHINE_TI_EEPROM
 extern const mp_obj_type_t machine_eeprom_type;
 extern void machine_eeprom_teardown(void);
+extern void machine_eeprom_init(void);
 
 #define MACHINE_EEPROM_CLASS { MP_ROM_QSTR(MP_QSTR_EEPROM), MP_ROM_PTR(&machine_eeprom_type) },
 #define MACHINE_EEPROM_TEARDOWN() machine_eeprom
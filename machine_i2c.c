@@ -15,7 +15,29 @@
 #include "py/runtime.h"
 #include "py/mperrno.h"
 
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
 #include <ti/drivers/I2C.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+// The driver is opened in callback mode, which lets a whole list of
+// transactions be handed to it at once: it runs them back to back from
+// its interrupt and i2c_run just waits for the last one.  scan() and
+// transfer_batch() use that directly; the single transfer methods are a
+// batch of one.
+//
+// The exception is the board's internal bus, MICROPY_HW_I2C_SHARED, which
+// tildaThread polls too.  That handle belongs to i2c_bus.c and each batch
+// goes through I2CBus_transfer, which keeps it from interleaving with
+// tildaThread's and lets button reads go first.
+
+#ifdef MICROPY_HW_I2C_SHARED
+#include "i2c_bus.h"
+#define I2C_IS_SHARED(self) ((self)->id == MICROPY_HW_I2C_SHARED)
+#else
+#define I2C_IS_SHARED(self) (false)
+#endif
 
 // TODO: remove after implementing the empty functions
 #pragma GCC diagnostic ignored "-Wunused-variable"
@@ -26,8 +48,18 @@ typedef struct _machine_i2c_obj_t {
     I2C_Handle i2c;
     uint8_t id;
     uint32_t baudrate;
+    Semaphore_Handle done;
 } machine_i2c_obj_t;
 
+// Shared by the transactions of one i2c_run, through their arg
+typedef struct _i2c_batch_t {
+    I2C_Transaction *first;
+    bool *ok;               // per transaction result, or NULL
+    volatile size_t remaining;
+    volatile size_t succeeded;
+    Semaphore_Handle done;
+} i2c_batch_t;
+
 extern const mp_obj_type_t machine_i2c_type;
 
 // TODO: how to size this table?
@@ -41,12 +73,71 @@ static machine_i2c_obj_t i2c_obj[NUM_I2C] = {
 void machine_i2c_teardown(void) {
     for (int i = 0; i < NUM_I2C; i++) {
         if (i2c_obj[i].i2c) {
-            I2C_close(i2c_obj[i].i2c);
+            if (!I2C_IS_SHARED(&i2c_obj[i])) {
+                I2C_close(i2c_obj[i].i2c);
+            }
             i2c_obj[i].i2c = NULL;
         }
+        if (i2c_obj[i].done) {
+            Semaphore_delete(&i2c_obj[i].done);
+        }
     }
 }
 
+static void i2c_callback(I2C_Handle handle, I2C_Transaction *trans, bool status) {
+    i2c_batch_t *batch = trans->arg;
+    if (batch->ok) {
+        batch->ok[trans - batch->first] = status;
+    }
+    if (status) {
+        batch->succeeded++;
+    }
+    if (--batch->remaining == 0) {
+        Semaphore_post(batch->done);
+    }
+}
+
+// Run n transactions back to back, filling in ok[] if it's given.  Returns
+// how many succeeded.
+static size_t i2c_run(machine_i2c_obj_t *self, I2C_Transaction *trans, size_t n, bool *ok) {
+    if (self->i2c == NULL) {
+        mp_raise_OSError(MP_EBADF);
+    }
+    if (n == 0) {
+        return 0;
+    }
+#ifdef MICROPY_HW_I2C_SHARED
+    if (I2C_IS_SHARED(self)) {
+        return I2CBus_transfer(trans, n, ok, I2CBus_PRIORITY_NORMAL);
+    }
+#endif
+
+    i2c_batch_t batch = {
+        .first = trans, .ok = ok, .remaining = n, .succeeded = 0, .done = self->done,
+    };
+    for (size_t i = 0; i < n; i++) {
+        trans[i].arg = &batch;
+        if (!I2C_transfer(self->i2c, &trans[i])) {
+            // not queued, so it will never call back
+            if (ok) {
+                ok[i] = false;
+            }
+            uint32_t key = HwiP_disable();
+            size_t remaining = --batch.remaining;
+            HwiP_restore(key);
+            if (remaining == 0) {
+                return batch.succeeded;
+            }
+        }
+    }
+    Semaphore_pend(self->done, BIOS_WAIT_FOREVER);
+    return batch.succeeded;
+}
+
+static bool i2c_transfer(machine_i2c_obj_t *self, I2C_Transaction *trans) {
+    return i2c_run(self, trans, 1, NULL) == 1;
+}
+
 static void i2c_init_helper(machine_i2c_obj_t * self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_baudrate, MP_ARG_INT, {.u_int = ~0u} },
@@ -60,6 +151,17 @@ static void i2c_init_helper(machine_i2c_obj_t * self, size_t n_args, const mp_ob
         self->baudrate = args[ARG_baudrate].u_int;
     }
 
+#ifdef MICROPY_HW_I2C_SHARED
+    if (I2C_IS_SHARED(self)) {
+        // the bus stays at the speed tildaThread set it up with
+        self->baudrate = 400000u;
+        if ((self->i2c = I2CBus_open()) == NULL) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+        return;
+    }
+#endif
+
     I2C_Params params;
     I2C_Params_init(&params);
     if (self->baudrate <= 100000u) {
@@ -75,8 +177,20 @@ static void i2c_init_helper(machine_i2c_obj_t * self, size_t n_args, const mp_ob
         params.bitRate = I2C_1000kHz;
     }
 
+    params.transferMode = I2C_MODE_CALLBACK;
+    params.transferCallbackFxn = i2c_callback;
+
     if (self->i2c) {
         I2C_close(self->i2c);
+        self->i2c = NULL;
+    }
+    if (self->done == NULL) {
+        Semaphore_Params sem_params;
+        Semaphore_Params_init(&sem_params);
+        sem_params.mode = Semaphore_Mode_BINARY;
+        if ((self->done = Semaphore_create(0, &sem_params, NULL)) == NULL) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
     }
 
     if ((self->i2c = I2C_open(self->id, &params)) == NULL) {
@@ -116,24 +230,33 @@ STATIC mp_obj_t machine_i2c_init(size_t n_args, const mp_obj_t *pos_args, mp_map
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_i2c_init_obj, 1, machine_i2c_init);
 
+// 7-bit addresses 0b0000xxx and 0b1111xxx are reserved
+#define SCAN_FIRST (0x08)
+#define SCAN_COUNT (0x78 - SCAN_FIRST)
+
 STATIC mp_obj_t machine_i2c_scan(mp_obj_t self_in) {
     machine_i2c_obj_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_t list = mp_obj_new_list(0, NULL);
-    I2C_Transaction trans;
+    I2C_Transaction *trans = m_new(I2C_Transaction, SCAN_COUNT);
+    bool ok[SCAN_COUNT];
     uint8_t data = 0;
 
-    trans.writeBuf = &data;
-    trans.writeCount = 1;
-    trans.readBuf = &data;
-    trans.readCount = 0;
+    // every probe goes to the driver in one go rather than one at a time
+    for (int i = 0; i < SCAN_COUNT; ++i) {
+        trans[i].slaveAddress = SCAN_FIRST + i;
+        trans[i].writeBuf = &data;
+        trans[i].writeCount = 1;
+        trans[i].readBuf = NULL;
+        trans[i].readCount = 0;
+    }
+    i2c_run(self, trans, SCAN_COUNT, ok);
 
-    // 7-bit addresses 0b0000xxx and 0b1111xxx are reserved
-    for (int addr = 0x08; addr < 0x78; ++addr) {
-        trans.slaveAddress = addr;
-        if (I2C_transfer(self->i2c, &trans)) {
-            mp_obj_list_append(list, MP_OBJ_NEW_SMALL_INT(addr));
+    for (int i = 0; i < SCAN_COUNT; ++i) {
+        if (ok[i]) {
+            mp_obj_list_append(list, MP_OBJ_NEW_SMALL_INT(SCAN_FIRST + i));
         }
     }
+    m_del(I2C_Transaction, trans, SCAN_COUNT);
 
     return list;
 }
@@ -149,7 +272,7 @@ static bool i2c_readfrom(machine_i2c_obj_t * self, mp_int_t addr, uint8_t * buf,
     trans.readBuf = buf;
     trans.readCount = len;
 
-    return I2C_transfer(self->i2c, &trans);
+    return i2c_transfer(self, &trans);
 }
 
 STATIC mp_obj_t machine_i2c_readfrom(size_t n_args, const mp_obj_t *args) {
@@ -196,7 +319,7 @@ STATIC mp_obj_t machine_i2c_writeto(size_t n_args, const mp_obj_t *args) {
     trans.writeCount = buf_info.len;
     trans.readBuf = NULL;
     trans.readCount = 0;
-    if (!I2C_transfer(self->i2c, &trans)) {
+    if (!i2c_transfer(self, &trans)) {
         mp_raise_OSError(MP_EIO);
     }
 
@@ -216,7 +339,7 @@ static bool i2c_readfrom_mem(machine_i2c_obj_t * self, mp_int_t addr, mp_int_t m
     trans.readBuf = buf;
     trans.readCount = len;
 
-    return I2C_transfer(self->i2c, &trans);
+    return i2c_transfer(self, &trans);
 }
 
 STATIC mp_obj_t machine_i2c_readfrom_mem(size_t n_args, const mp_obj_t *args) {
@@ -290,7 +413,7 @@ STATIC mp_obj_t machine_i2c_writeto_mem(size_t n_args, const mp_obj_t *args) {
     trans.writeCount = memaddr_len + len;
     trans.readBuf = NULL;
     trans.readCount = 0;
-    bool status = I2C_transfer(self->i2c, &trans);
+    bool status = i2c_transfer(self, &trans);
 
     if (buf2_alloc != 0) {
         m_del(uint8_t, buf2, buf2_alloc);
@@ -305,6 +428,59 @@ STATIC mp_obj_t machine_i2c_writeto_mem(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_i2c_writeto_mem_obj, 4, 4, machine_i2c_writeto_mem);
 
+/*
+ * transfer_batch([(addr, wbuf, rbuf), ...]) -> run every segment back to
+ * back in one driver call.  wbuf is written then rbuf is filled, with a
+ * repeated start between; either can be None.  Raises OSError(EIO, index)
+ * for the first segment that failed, after the rest have still been run.
+ */
+STATIC mp_obj_t machine_i2c_transfer_batch(mp_obj_t self_in, mp_obj_t segs_in) {
+    machine_i2c_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t n;
+    mp_obj_t *segs;
+    mp_obj_get_array(segs_in, &n, &segs);
+
+    I2C_Transaction *trans = m_new(I2C_Transaction, n);
+    bool *ok = m_new(bool, n);
+    for (size_t i = 0; i < n; i++) {
+        mp_obj_t *seg;
+        mp_obj_get_array_fixed_n(segs[i], 3, &seg);
+        trans[i].slaveAddress = mp_obj_get_int(seg[0]);
+        trans[i].writeBuf = NULL;
+        trans[i].writeCount = 0;
+        trans[i].readBuf = NULL;
+        trans[i].readCount = 0;
+        mp_buffer_info_t buf_info;
+        if (seg[1] != mp_const_none) {
+            mp_get_buffer_raise(seg[1], &buf_info, MP_BUFFER_READ);
+            trans[i].writeBuf = buf_info.buf;
+            trans[i].writeCount = buf_info.len;
+        }
+        if (seg[2] != mp_const_none) {
+            mp_get_buffer_raise(seg[2], &buf_info, MP_BUFFER_WRITE);
+            trans[i].readBuf = buf_info.buf;
+            trans[i].readCount = buf_info.len;
+        }
+    }
+
+    size_t succeeded = i2c_run(self, trans, n, ok);
+    size_t failed = 0;
+    while (failed < n && ok[failed]) {
+        failed++;
+    }
+    m_del(I2C_Transaction, trans, n);
+    m_del(bool, ok, n);
+
+    if (succeeded != n) {
+        mp_obj_t args[2] = { MP_OBJ_NEW_SMALL_INT(MP_EIO), MP_OBJ_NEW_SMALL_INT(failed) };
+        nlr_raise(mp_obj_new_exception_args(&mp_type_OSError, 2, args));
+    }
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(machine_i2c_transfer_batch_obj, machine_i2c_transfer_batch);
+
 STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_i2c_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&machine_i2c_scan_obj) },
@@ -314,6 +490,7 @@ STATIC const mp_rom_map_elem_t machine_i2c_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem), MP_ROM_PTR(&machine_i2c_readfrom_mem_obj) },
     { MP_ROM_QSTR(MP_QSTR_readfrom_mem_into), MP_ROM_PTR(&machine_i2c_readfrom_mem_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_writeto_mem), MP_ROM_PTR(&machine_i2c_writeto_mem_obj) },
+    { MP_ROM_QSTR(MP_QSTR_transfer_batch), MP_ROM_PTR(&machine_i2c_transfer_batch_obj) },
 #ifdef MACHINE_I2C_IDS
     MACHINE_I2C_IDS
 #endif
@@ -31,6 +31,285 @@
 #include "py/misc.h"
 #include "led.h"
 
+#if MICROPY_HW_FLASH_FTL
+
+// The FAT volume sits on flash_ftl.c, which never rewrites a sector in
+// place: no cache, no flush thread, and a reset can only lose the block
+// being written.
+//
+// A volume from before the FTL is moved over at boot without ever being
+// at risk: the new volume is made in the sectors the old one isn't using,
+// the files are copied and checked, and only then does the FTL take the
+// rest (see ftl_release_held).  Until that point the old volume is what
+// mounts, read-only, and a reset just means the copy starts again.
+
+#include "extmod/vfs_fat.h"
+#include "lib/oofatfs/ff.h"
+#include "flash_ftl.h"
+
+#define LEGACY_NUM_BLOCKS (2048) // size of the volume written before the FTL
+
+static NVS_Handle nvs_handle;
+static bool legacy;
+
+void flash_bdev_init(void) {
+    NVS_Params params;
+    NVS_Params_init(&params);
+    if (!(nvs_handle = NVS_open(0, &params))) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+    int state = ftl_mount(nvs_handle);
+    if (state == FTL_MOUNT_ERROR) {
+        mp_raise_OSError(MP_EIO);
+    }
+    legacy = state == FTL_MOUNT_LEGACY;
+}
+
+void flash_bdev_flush(void) {
+}
+
+int32_t flash_bdev_ioctl(uint32_t op, uint32_t arg) {
+    (void)arg;
+    switch (op) {
+        case BDEV_IOCTL_INIT:
+            flash_bdev_init();
+            return 0;
+
+        case BDEV_IOCTL_NUM_BLOCKS:
+            return legacy ? LEGACY_NUM_BLOCKS : ftl_block_count();
+
+        case BDEV_IOCTL_SYNC:
+            return 0;
+    }
+    return -MP_EINVAL;
+}
+
+bool flash_bdev_readblock(uint8_t *dest, uint32_t block) {
+    if (legacy) {
+        return block < LEGACY_NUM_BLOCKS
+            && NVS_read(nvs_handle, block * FLASH_BLOCK_SIZE, dest, FLASH_BLOCK_SIZE) == NVS_STATUS_SUCCESS;
+    }
+    return ftl_read(dest, block);
+}
+
+bool flash_bdev_writeblock(const uint8_t *src, uint32_t block) {
+    if (legacy) {
+        // the old volume is only read until it has been moved
+        return false;
+    }
+    return ftl_write(src, block);
+}
+
+bool flash_bdev_is_legacy(void) {
+    return legacy;
+}
+
+// Throws the old volume away for a fresh one, on a factory reset.
+bool flash_bdev_drop_legacy(void) {
+    if (legacy && !ftl_format()) {
+        return false;
+    }
+    legacy = false;
+    return true;
+}
+
+static mp_uint_t legacy_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    if (block_num + num_blocks > LEGACY_NUM_BLOCKS
+        || NVS_read(nvs_handle, block_num * FLASH_BLOCK_SIZE, dest, num_blocks * FLASH_BLOCK_SIZE) != NVS_STATUS_SUCCESS) {
+        return 1;
+    }
+    return 0;
+}
+
+static void hold_blocks(uint8_t *held, uint32_t block, uint32_t count) {
+    for (uint32_t s = block * FLASH_BLOCK_SIZE / FTL_SECTOR_SIZE;
+         s <= (block + count - 1) * FLASH_BLOCK_SIZE / FTL_SECTOR_SIZE; s++) {
+        held[s / 8] |= 1 << (s % 8);
+    }
+}
+
+// Marks the sectors the old volume has anything in: everything up to the
+// data area, and every allocated cluster.
+static bool legacy_held(FATFS *fs, uint8_t *held) {
+    memset(held, 0, FTL_MAX_SECTORS / 8);
+    hold_blocks(held, 0, fs->database);
+
+    size_t fat_len = fs->fsize * FLASH_BLOCK_SIZE;
+    uint8_t *fat = m_new_maybe(uint8_t, fat_len);
+    if (fat == NULL) {
+        return false;
+    }
+    bool ok = legacy_read_blocks(fat, fs->fatbase, fs->fsize) == 0;
+    for (uint32_t c = 2; ok && c < fs->n_fatent; c++) {
+        uint32_t next;
+        if (fs->fs_type == FS_FAT12) {
+            uint32_t off = c + c / 2;
+            next = fat[off] | (fat[off + 1] << 8);
+            next = c & 1 ? next >> 4 : next & 0xfff;
+        } else if (fs->fs_type == FS_FAT16) {
+            next = fat[c * 2] | (fat[c * 2 + 1] << 8);
+        } else {
+            next = (fat[c * 4] | (fat[c * 4 + 1] << 8) | (fat[c * 4 + 2] << 16)
+                | ((uint32_t)fat[c * 4 + 3] << 24)) & 0x0fffffff;
+        }
+        if (next != 0) {
+            hold_blocks(held, fs->database + (c - 2) * fs->csize, fs->csize);
+        }
+    }
+    m_del(uint8_t, fat, fat_len);
+    return ok;
+}
+
+enum { WALK_COUNT, WALK_COPY, WALK_VERIFY };
+
+static char migrate_path[256];
+static FIL migrate_src;
+static FIL migrate_dst;
+static uint8_t migrate_buf[FLASH_BLOCK_SIZE];
+static uint8_t migrate_check[FLASH_BLOCK_SIZE];
+static uint32_t migrate_clusters;   // needed on the new volume, for WALK_COUNT
+
+static bool migrate_file(FATFS *src, FATFS *dst, int op) {
+    if (f_open(src, &migrate_src, migrate_path, FA_READ) != FR_OK) {
+        return false;
+    }
+    bool ok = f_open(dst, &migrate_dst, migrate_path,
+        op == WALK_COPY ? FA_WRITE | FA_CREATE_ALWAYS : FA_READ) == FR_OK;
+    if (ok) {
+        UINT n, m;
+        while ((ok = f_read(&migrate_src, migrate_buf, sizeof(migrate_buf), &n) == FR_OK) && n > 0) {
+            if (op == WALK_COPY) {
+                ok = f_write(&migrate_dst, migrate_buf, n, &m) == FR_OK && m == n;
+            } else {
+                ok = f_read(&migrate_dst, migrate_check, n, &m) == FR_OK && m == n
+                    && memcmp(migrate_buf, migrate_check, n) == 0;
+            }
+            if (!ok) {
+                break;
+            }
+        }
+        ok = ok && f_size(&migrate_src) == f_size(&migrate_dst);
+        ok = f_close(&migrate_dst) == FR_OK && ok;
+    }
+    f_close(&migrate_src);
+    return ok;
+}
+
+// Counts, copies or checks the tree under migrate_path, which is len long.
+static bool migrate_walk(FATFS *src, FATFS *dst, size_t len, int op) {
+    uint32_t cluster_bytes = dst->csize * FLASH_BLOCK_SIZE;
+    uint32_t dir_bytes = 2 * 32; // "." and ".."
+    FF_DIR dir;
+    FILINFO fno;
+    if (f_opendir(src, &dir, len ? migrate_path : "/") != FR_OK) {
+        return false;
+    }
+    bool ok = true;
+    while (ok && f_readdir(&dir, &fno) == FR_OK && fno.fname[0] != 0) {
+        if (fno.fname[0] == '.' && (fno.fname[1] == '\0' || (fno.fname[1] == '.' && fno.fname[2] == '\0'))) {
+            continue;
+        }
+        size_t name_len = strlen(fno.fname);
+        if (len + 1 + name_len >= sizeof(migrate_path)) {
+            ok = false;
+            break;
+        }
+        // a short entry, and long name entries of 13 characters each
+        dir_bytes += 32 * (1 + (name_len + 12) / 13);
+        migrate_path[len] = '/';
+        memcpy(migrate_path + len + 1, fno.fname, name_len + 1);
+        if (fno.fattrib & AM_DIR) {
+            if (op == WALK_COPY) {
+                FRESULT res = f_mkdir(dst, migrate_path);
+                ok = res == FR_OK || res == FR_EXIST;
+            }
+            ok = ok && migrate_walk(src, dst, len + 1 + name_len, op);
+        } else if (!(fno.fattrib & AM_VOL)) {
+            if (op == WALK_COUNT) {
+                migrate_clusters += (fno.fsize + cluster_bytes - 1) / cluster_bytes;
+            } else {
+                ok = migrate_file(src, dst, op);
+            }
+        }
+        migrate_path[len] = '\0';
+    }
+    f_closedir(&dir);
+    // the root directory of FAT12/16 has an area of its own
+    if (len > 0) {
+        migrate_clusters += (dir_bytes + cluster_bytes - 1) / cluster_bytes;
+    }
+    return ok;
+}
+
+// Moves the old volume onto a new one made on vfs.  Returns
+// FLASH_MIGRATE_FULL, without copying anything, if the files wouldn't all
+// fit; on anything but FLASH_MIGRATE_OK the old volume is left as it was
+// and is what mounts.
+int flash_bdev_migrate(fs_user_mount_t *vfs) {
+    static fs_user_mount_t legacy_vfs;
+    static uint8_t held[FTL_MAX_SECTORS / 8];
+    legacy_vfs.base.type = &mp_fat_vfs_type;
+    legacy_vfs.flags = FSUSER_NATIVE;
+    legacy_vfs.fatfs.drv = &legacy_vfs;
+    legacy_vfs.fatfs.part = 0; // the volume starts at block 0, no MBR
+    legacy_vfs.readblocks[2] = (mp_obj_t)legacy_read_blocks;
+    legacy_vfs.writeblocks[2] = MP_OBJ_NULL;
+    legacy_vfs.u.old.sync[0] = MP_OBJ_NULL;
+    legacy_vfs.u.old.count[0] = MP_OBJ_NULL;
+
+    if (!legacy || f_mount(&legacy_vfs.fatfs) != FR_OK) {
+        return FLASH_MIGRATE_ERROR;
+    }
+    FATFS *src = &legacy_vfs.fatfs;
+    FATFS *dst = &vfs->fatfs;
+    int result = FLASH_MIGRATE_ERROR;
+
+    // a fresh volume around the old one, with its label
+    if (!legacy_held(src, held) || !ftl_format_around(held)) {
+        goto done;
+    }
+    legacy = false;
+    char label[12];
+    if (f_mkfs(dst, FM_FAT, 0, migrate_buf, sizeof(migrate_buf)) != FR_OK
+        || f_mount(dst) != FR_OK) {
+        goto done;
+    }
+    if (f_getlabel(src, label, NULL) == FR_OK && label[0] != '\0') {
+        f_setlabel(dst, label);
+    }
+
+    // both the new volume and the flash it has for now must have room
+    DWORD free_clusters;
+    migrate_clusters = 0;
+    migrate_path[0] = '\0';
+    if (f_getfree(dst, &free_clusters) != FR_OK || !migrate_walk(src, dst, 0, WALK_COUNT)) {
+        goto done;
+    }
+    if (migrate_clusters > free_clusters
+        || migrate_clusters * dst->csize > ftl_room_blocks()) {
+        result = FLASH_MIGRATE_FULL;
+        goto done;
+    }
+
+    if (!migrate_walk(src, dst, 0, WALK_COPY) || !migrate_walk(src, dst, 0, WALK_VERIFY)) {
+        goto done;
+    }
+
+    // From here on the new volume is the one that mounts.  If this fails
+    // the old volume is still intact, and the copy is made again next boot.
+    ftl_release_held();
+    result = FLASH_MIGRATE_OK;
+
+done:
+    f_umount(src);
+    if (result != FLASH_MIGRATE_OK) {
+        legacy = true;
+    }
+    return result;
+}
+
+#else
+
 static SemaphoreP_Handle flushFlashBdevCache;
 static SemaphoreP_Handle flushFlashBdevClean;
 
@@ -240,4 +519,6 @@ bool flash_bdev_writeblock(const uint8_t *src, uint32_t block) {
     return true;
 }
 
-#endif
\ No newline at end of file
+#endif // MICROPY_HW_FLASH_FTL
+
+#endif
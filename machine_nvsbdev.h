@@ -4,4 +4,18 @@ void * flash_bdev_flush_thread(void * arg);
 uint32_t flash_get_sector_info(uint32_t addr, uint32_t *start_addr, uint32_t *size);
 void flash_bdev_init(void);
 void flash_bdev_flush(void);
+
+#if MICROPY_HW_FLASH_FTL
+// results of flash_bdev_migrate()
+enum {
+    FLASH_MIGRATE_OK,
+    FLASH_MIGRATE_FULL,     // the files wouldn't fit on the new volume
+    FLASH_MIGRATE_ERROR,
+};
+
+struct _fs_user_mount_t;
+bool flash_bdev_is_legacy(void);
+bool flash_bdev_drop_legacy(void);
+int flash_bdev_migrate(struct _fs_user_mount_t *vfs);
+#endif
 #endif
\ No newline at end of file
@@ -12,9 +12,14 @@
 #include <stdbool.h>
 
 #include "py/runtime.h"
+#include "py/mphal.h"
+
+#include "modmachine.h"
+#include "machine_pin.h"
 
 #include <ti/sysbios/knl/Semaphore.h>
 #include <ti/drivers/GPIO.h>
+#include <ti/drivers/dpl/HwiP.h>
 
 #define PULL_UP     0x4u
 #define PULL_DOWN   0x8u
@@ -29,14 +34,50 @@ typedef struct _machine_pin_obj_t {
 
 static bool irq_in_use[NUM_PINS];
 
+// Edge capture.  Pins set up with irq(capture=True) store every edge as
+// (pin, level, ticks_us) from the GPIO Hwi in one ring shared by all
+// capturing pins, so the order of edges across pins is kept.  The handler
+// of the pin with the latest edge is scheduled whenever the ring has
+// something in it and a call isn't already pending, and is expected to
+// drain it with Pin.capture_read(); if it leaves some behind, or the
+// schedule queue was full, it is called again.
+#define CAPTURE_LEN 256  // events, power of two
+
+typedef struct _capture_event_t {
+    uint32_t ticks_us;
+    uint8_t pin;
+    uint8_t level;
+} capture_event_t;
+
+typedef struct _capture_ring_t {
+    volatile uint32_t head;  // advanced by the Hwi
+    volatile uint32_t tail;  // advanced by capture_read()
+    uint32_t lost;
+    volatile bool pending;   // a handler call is queued
+    uint8_t notify;          // whose handler to call
+    capture_event_t events[CAPTURE_LEN];
+} capture_ring_t;
+
+static bool irq_capture[NUM_PINS];
+
 void machine_pin_teardown(void) {
     for (uint32_t i = 0; i < NUM_PINS; i++) {
         if (irq_in_use[i]) {
             GPIO_disableInt(i);
             GPIO_setCallback(i, NULL);
             irq_in_use[i] = false;
+            irq_capture[i] = false;
         }
     }
+    MP_STATE_PORT(machine_pin_capture) = NULL;
+}
+
+uint32_t machine_pin_get_id(mp_obj_t pin_in) {
+    if (!MP_OBJ_IS_TYPE(pin_in, &machine_pin_type)) {
+        mp_raise_TypeError("expecting a Pin");
+    }
+    machine_pin_obj_t *self = MP_OBJ_TO_PTR(pin_in);
+    return self->id;
 }
 
 STATIC mp_obj_t machine_pin_obj_init_helper(machine_pin_obj_t *self, mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -246,13 +287,66 @@ STATIC mp_obj_t machine_pin_drive(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(machine_pin_drive_obj, 1, machine_pin_drive);
 
+STATIC mp_obj_t capture_dispatch(mp_obj_t index_in) {
+    capture_ring_t *ring = MP_STATE_PORT(machine_pin_capture);
+    if (ring == NULL) {
+        return mp_const_none;
+    }
+    ring->pending = false;
+    mp_obj_t cb = MP_STATE_PORT(pinirq_callback)[MP_OBJ_SMALL_INT_VALUE(index_in)];
+    if (cb != mp_const_none) {
+        mp_call_function_1(cb, mp_const_none);
+    }
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(capture_dispatch_obj, capture_dispatch);
+
+// Schedules the capture handler if there is something to read and it
+// isn't queued already.  Called with interrupts disabled.
+static void capture_notify(capture_ring_t *ring) {
+    if (ring->pending || ring->head == ring->tail
+        || MP_STATE_PORT(pinirq_callback)[ring->notify] == mp_const_none) {
+        return;
+    }
+    if (mp_sched_schedule(MP_OBJ_FROM_PTR(&capture_dispatch_obj),
+        MP_OBJ_NEW_SMALL_INT(ring->notify))) {
+        ring->pending = true;
+    }
+}
+
+// Runs in the GPIO Hwi
+static void capture_edge(uint8_t index) {
+    capture_ring_t *ring = MP_STATE_PORT(machine_pin_capture);
+    uint32_t now = mp_hal_ticks_us();
+    uint8_t level = GPIO_read(index);
+
+    uint32_t key = HwiP_disable();
+    uint32_t head = ring->head;
+    if (head - ring->tail == CAPTURE_LEN) {
+        ring->lost++;
+    } else {
+        capture_event_t *ev = &ring->events[head & (CAPTURE_LEN - 1)];
+        ev->ticks_us = now;
+        ev->pin = index;
+        ev->level = level;
+        ring->head = head + 1;
+    }
+    if (MP_STATE_PORT(pinirq_callback)[index] != mp_const_none) {
+        ring->notify = index;
+    }
+    capture_notify(ring);
+    HwiP_restore(key);
+}
+
 static void gpioCallback(uint8_t index) {
     mp_obj_t *cb = &MP_STATE_PORT(pinirq_callback)[index];
-    if (*cb != mp_const_none) {
+    if (irq_capture[index]) {
+        capture_edge(index);
+    } else if (*cb != mp_const_none) {
         mp_sched_schedule(*cb, mp_const_none);
     }
-    extern Semaphore_Handle machine_sleep_sem;
-    Semaphore_post(machine_sleep_sem);
+    machine_wake(MACHINE_PIN_WAKE);
 }
 
 STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -262,18 +356,24 @@ STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_
         { MP_QSTR_trigger, MP_ARG_INT, {.u_int = 0} },
         { MP_QSTR_priority, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
         { MP_QSTR_wake, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_capture, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
-    enum { ARG_handler, ARG_trigger, ARG_priority, ARG_wake };
+    enum { ARG_handler, ARG_trigger, ARG_priority, ARG_wake, ARG_capture };
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
         MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
     mp_obj_t *cb = &MP_STATE_PORT(pinirq_callback)[self->id];
 
+    if (args[ARG_capture].u_bool && MP_STATE_PORT(machine_pin_capture) == NULL) {
+        MP_STATE_PORT(machine_pin_capture) = m_new0(capture_ring_t, 1);
+    }
+
     GPIO_disableInt(self->id);
     *cb = args[ARG_handler].u_obj;
     GPIO_setCallback(self->id, gpioCallback);
     irq_in_use[self->id] = true;
+    irq_capture[self->id] = args[ARG_capture].u_bool;
     GPIO_enableInt(self->id);
 
     // TODO: fix result
@@ -284,6 +384,62 @@ STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_pin_irq_obj, 1, machine_pin_irq);
 
+/* capture_read(buf) -> drain captured edges into a 32-bit array */
+STATIC mp_obj_t machine_pin_capture_read(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.typecode != 'I' && bufinfo.typecode != 'L') {
+        mp_raise_ValueError("expecting array('I')");
+    }
+
+    capture_ring_t *ring = MP_STATE_PORT(machine_pin_capture);
+    if (ring == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
+    // each event fills three words: pin, level, ticks_us
+    uint32_t *out = bufinfo.buf;
+    size_t room = bufinfo.len / (3 * sizeof(uint32_t));
+    uint32_t tail = ring->tail;
+    size_t n = 0;
+    while (n < room && tail != ring->head) {
+        capture_event_t *ev = &ring->events[tail & (CAPTURE_LEN - 1)];
+        *out++ = ev->pin;
+        *out++ = ev->level;
+        *out++ = ev->ticks_us;
+        tail++;
+        n++;
+    }
+
+    uint32_t key = HwiP_disable();
+    ring->tail = tail;
+    capture_notify(ring);
+    HwiP_restore(key);
+
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pin_capture_read_fun_obj, machine_pin_capture_read);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(machine_pin_capture_read_obj, MP_ROM_PTR(&machine_pin_capture_read_fun_obj));
+
+/* capture_lost() -> edges dropped on a full ring since the last call */
+STATIC mp_obj_t machine_pin_capture_lost(void) {
+    capture_ring_t *ring = MP_STATE_PORT(machine_pin_capture);
+    if (ring == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
+    uint32_t key = HwiP_disable();
+    uint32_t lost = ring->lost;
+    ring->lost = 0;
+    HwiP_restore(key);
+
+    return mp_obj_new_int_from_uint(lost);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_pin_capture_lost_fun_obj, machine_pin_capture_lost);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(machine_pin_capture_lost_obj, MP_ROM_PTR(&machine_pin_capture_lost_fun_obj));
+
 STATIC const mp_rom_map_elem_t machine_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_pin_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&machine_pin_value_obj) },
@@ -293,6 +449,8 @@ STATIC const mp_rom_map_elem_t machine_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pull), MP_ROM_PTR(&machine_pin_pull_obj) },
     { MP_ROM_QSTR(MP_QSTR_drive), MP_ROM_PTR(&machine_pin_drive_obj) },
     { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&machine_pin_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_read), MP_ROM_PTR(&machine_pin_capture_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_lost), MP_ROM_PTR(&machine_pin_capture_lost_obj) },
     { MP_ROM_QSTR(MP_QSTR_IN), MP_ROM_INT(GPIO_CFG_INPUT) },
     { MP_ROM_QSTR(MP_QSTR_OUT), MP_ROM_INT(GPIO_CFG_OUTPUT) },
     { MP_ROM_QSTR(MP_QSTR_PULL_UP), MP_ROM_INT(PULL_UP) },
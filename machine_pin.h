@@ -3,5 +3,6 @@
 
 extern const mp_obj_type_t machine_pin_type;
 extern void machine_pin_teardown(void);
+extern uint32_t machine_pin_get_id(mp_obj_t pin_in);
 
 #endif
@@ -13,8 +13,20 @@
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/binary.h"
 
+#include "ti/devices/msp432e4/driverlib/driverlib.h"
+#include <ti/sysbios/BIOS.h>
 #include <ti/drivers/PWM.h>
+#include <ti/drivers/pwm/PWMMSP432E4.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerMSP432E4.h>
+#include <ti/drivers/dma/UDMAMSP432E4.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#if MICROPY_HW_HAS_NEOPIX
+#include "neopix.h"
+#endif
 
 typedef struct _machine_pwm_obj_t {
     mp_obj_base_t base;
@@ -35,7 +47,105 @@ static machine_pwm_obj_t pwm_obj[NUM_PWM] = {
     {{&machine_pwm_type}, .id = 3, .freq = 1000, .duty = 0},
 };
 
+// play() streams precomputed compare values into the generator's CMPA/CMPB
+// register with uDMA, paced by TIMER3A timing out at the sample rate.  The
+// PWM module can't request DMA itself, so the timer is borrowed from the
+// neopixels, and only one PWM can play at a time.  Transfers are queued in
+// ping-pong mode a chunk at a time, so sequences longer than one uDMA
+// transfer, and loops, run without gaps.
+#define PLAY_TIMER_BASE     TIMER3_BASE
+#define PLAY_DMA_CHANNEL    UDMA_CH2_TIMER3A
+#define PLAY_CHUNK          (1024)  // most items in one uDMA transfer
+
+// offsets of the compare registers in a generator block
+#define PWM_GEN_CMPA        (0x18)
+#define PWM_GEN_CMPB        (0x1c)
+
+typedef struct _pwm_play_t {
+    machine_pwm_obj_t *owner;   // NULL when nothing is playing
+    uint32_t *buf;              // compare values, in machine_pwm_play_buf
+    size_t len;
+    size_t next;                // first item not yet queued
+    bool loop;
+    volatile bool armed[2];     // primary and alternate control structures
+    uint32_t cmp_reg;
+} pwm_play_t;
+
+static pwm_play_t play;
+static HwiP_Handle play_hwi;
+static UDMAMSP432E4_Handle play_dma;
+
+static void play_queue(uint32_t sel, int i) {
+    if (play.next >= play.len) {
+        if (!play.loop) {
+            return;
+        }
+        play.next = 0;
+    }
+    size_t n = MIN(play.len - play.next, PLAY_CHUNK);
+    MAP_uDMAChannelTransferSet(PLAY_DMA_CHANNEL | sel, UDMA_MODE_PINGPONG,
+        &play.buf[play.next], (void *)play.cmp_reg, n);
+    play.next += n;
+    play.armed[i] = true;
+}
+
+static void play_requeue(uint32_t sel, int i) {
+    if (play.armed[i] && MAP_uDMAChannelModeGet(PLAY_DMA_CHANNEL | sel) == UDMA_MODE_STOP) {
+        play.armed[i] = false;
+        play_queue(sel, i);
+    }
+}
+
+static void play_halt(void) {
+    MAP_TimerDisable(PLAY_TIMER_BASE, TIMER_A);
+    MAP_TimerIntDisable(PLAY_TIMER_BASE, TIMER_TIMA_DMA);
+    MAP_TimerIntClear(PLAY_TIMER_BASE, TIMER_TIMA_DMA);
+    MAP_uDMAChannelDisable(PLAY_DMA_CHANNEL);
+    play.armed[0] = play.armed[1] = false;
+}
+
+// Stops playback and hands the timer back.  Safe from the ISR.
+static void play_release(void) {
+    play_halt();
+    play.owner = NULL;
+    Power_releaseDependency(PowerMSP432E4_PERIPH_TIMER3);
+#if MICROPY_HW_HAS_NEOPIX
+    neopix_return_timer();
+#endif
+}
+
+static void play_isr(uintptr_t arg) {
+    MAP_TimerIntClear(PLAY_TIMER_BASE, TIMER_TIMA_DMA);
+
+    play_requeue(UDMA_PRI_SELECT, 0);
+    play_requeue(UDMA_ALT_SELECT, 1);
+
+    if (!play.armed[0] && !play.armed[1] && play.owner != NULL) {
+        // the last value written stays in the compare register
+        machine_pwm_obj_t *owner = play.owner;
+        play_release();
+        mp_obj_t cb = MP_STATE_PORT(machine_pwm_play_callback);
+        if (cb != mp_const_none) {
+            mp_sched_schedule(cb, MP_OBJ_FROM_PTR(owner));
+        }
+    }
+}
+
+// The compare buffer stays in machine_pwm_play_buf until the next play()
+// so it can't be collected while a transfer is still reading it.
+static void play_stop(void) {
+    uint32_t key = HwiP_disable();
+    if (play.owner != NULL) {
+        play_release();
+    }
+    HwiP_restore(key);
+}
+
 void machine_pwm_teardown(void) {
+    play_stop();
+    MP_STATE_PORT(machine_pwm_play_callback) = mp_const_none;
+    MP_STATE_PORT(machine_pwm_play_buf) = NULL;
+
     for (int i = 0; i < NUM_PWM; i++) {
         if (pwm_obj[i].pwm) {
             PWM_close(pwm_obj[i].pwm);
@@ -78,6 +188,9 @@ static void pwm_init_helper(machine_pwm_obj_t *self, size_t n_args, const mp_obj
     params.dutyValue = scale_duty(self->duty);
 
     if (self->pwm) {
+        if (play.owner == self) {
+            play_stop();
+        }
         PWM_close(self->pwm);
     }
 
@@ -156,10 +269,144 @@ STATIC mp_obj_t machine_pwm_duty(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(machine_pwm_duty_obj, 1, machine_pwm_duty);
 
+/* play(duties, rate, loop=False, *, callback=None)
+ * duties is an array of 0-65535 duty values, output one per 1/rate seconds.
+ * play(None) stops playback. */
+STATIC mp_obj_t machine_pwm_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_duties, ARG_rate, ARG_loop, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_duties, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_rate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_loop, MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    machine_pwm_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_duties].u_obj == mp_const_none) {
+        if (play.owner == self) {
+            play_stop();
+        }
+        return mp_const_none;
+    }
+
+    if (play.owner != NULL && play.owner != self) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_duties].u_obj, &bufinfo, MP_BUFFER_READ);
+    size_t len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+    if (len == 0) {
+        mp_raise_ValueError("no duties");
+    }
+
+    xdc_runtime_Types_FreqHz freq;
+    BIOS_getCpuFreq(&freq);
+    mp_int_t rate = args[ARG_rate].u_int;
+    // leave the uDMA plenty of cycles per request
+    if (rate <= 0 || rate > freq.lo / 64) {
+        mp_raise_ValueError("rate out of range");
+    }
+
+    // convert to compare values up front so the transfer is a plain copy;
+    // the generator counts down and goes low on the compare match
+    PWMMSP432E4_HWAttrs const *hw = self->pwm->hwAttrs;
+    uint32_t gen = hw->pwmOutput & 0xffffffc0;
+    uint32_t load = MAP_PWMGenPeriodGet(hw->pwmBaseAddr, gen) - 1;
+    uint32_t *buf = m_new(uint32_t, len);
+    for (size_t i = 0; i < len; i++) {
+        mp_int_t duty = mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, i));
+        duty = duty < 0 ? 0 : duty > 65535 ? 65535 : duty;
+        buf[i] = load - (uint32_t)((uint64_t)load * duty / 65535);
+    }
+
+    if (play_dma == NULL) {
+        UDMAMSP432E4_init();
+        if ((play_dma = UDMAMSP432E4_open()) == NULL) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+    }
+    if (play_hwi == NULL) {
+        HwiP_Params params;
+        HwiP_Params_init(&params);
+        params.enableInt = true;
+        if ((play_hwi = HwiP_create(INT_TIMER3A, play_isr, &params)) == NULL) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+
+    play_stop();
+
+#if MICROPY_HW_HAS_NEOPIX
+    if (!neopix_lend_timer()) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+#endif
+
+    MP_STATE_PORT(machine_pwm_play_buf) = buf;
+    MP_STATE_PORT(machine_pwm_play_callback) = args[ARG_callback].u_obj;
+
+    Power_setDependency(PowerMSP432E4_PERIPH_TIMER3);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+    MAP_TimerDisable(PLAY_TIMER_BASE, TIMER_BOTH);
+    MAP_TimerIntDisable(PLAY_TIMER_BASE, TIMER_TIMB_DMA);
+    MAP_TimerConfigure(PLAY_TIMER_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(PLAY_TIMER_BASE, TIMER_A, freq.lo / rate - 1);
+    MAP_TimerDMAEventSet(PLAY_TIMER_BASE, TIMER_DMA_TIMEOUT_A);
+
+    MAP_uDMAChannelAssign(PLAY_DMA_CHANNEL);
+    MAP_uDMAChannelAttributeDisable(PLAY_DMA_CHANNEL,
+        UDMA_ATTR_ALTSELECT | UDMA_ATTR_USEBURST | UDMA_ATTR_HIGH_PRIORITY | UDMA_ATTR_REQMASK);
+    MAP_uDMAChannelAttributeEnable(PLAY_DMA_CHANNEL, UDMA_ATTR_HIGH_PRIORITY);
+    MAP_uDMAChannelControlSet(PLAY_DMA_CHANNEL | UDMA_PRI_SELECT,
+        UDMA_SIZE_32 | UDMA_SRC_INC_32 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+    MAP_uDMAChannelControlSet(PLAY_DMA_CHANNEL | UDMA_ALT_SELECT,
+        UDMA_SIZE_32 | UDMA_SRC_INC_32 | UDMA_DST_INC_NONE | UDMA_ARB_1);
+
+    play.owner = self;
+    play.buf = buf;
+    play.len = len;
+    play.next = 0;
+    play.loop = args[ARG_loop].u_bool;
+    play.cmp_reg = hw->pwmBaseAddr + gen + ((hw->pwmOutput & 1) ? PWM_GEN_CMPB : PWM_GEN_CMPA);
+
+    // ControlSet leaves the mode alone, so a structure this play doesn't
+    // queue (the alternate, for one short chunk) could still hold a
+    // ping-pong descriptor from the last one; stop both before queueing
+    MAP_uDMAChannelTransferSet(PLAY_DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_MODE_STOP,
+        buf, (void *)play.cmp_reg, 1);
+    MAP_uDMAChannelTransferSet(PLAY_DMA_CHANNEL | UDMA_ALT_SELECT, UDMA_MODE_STOP,
+        buf, (void *)play.cmp_reg, 1);
+    play_queue(UDMA_PRI_SELECT, 0);
+    play_queue(UDMA_ALT_SELECT, 1);
+
+    MAP_uDMAChannelEnable(PLAY_DMA_CHANNEL);
+    MAP_TimerIntClear(PLAY_TIMER_BASE, TIMER_TIMA_DMA);
+    MAP_TimerIntEnable(PLAY_TIMER_BASE, TIMER_TIMA_DMA);
+    MAP_TimerEnable(PLAY_TIMER_BASE, TIMER_A);
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_pwm_play_obj, 2, machine_pwm_play);
+
+/* playing() -> True while a play() sequence is running on this PWM */
+STATIC mp_obj_t machine_pwm_playing(mp_obj_t self_in) {
+    machine_pwm_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(play.owner == self);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pwm_playing_obj, machine_pwm_playing);
+
 STATIC const mp_rom_map_elem_t machine_pwm_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_pwm_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_freq), MP_ROM_PTR(&machine_pwm_freq_obj) },
     { MP_ROM_QSTR(MP_QSTR_duty), MP_ROM_PTR(&machine_pwm_duty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&machine_pwm_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_playing), MP_ROM_PTR(&machine_pwm_playing_obj) },
 #ifdef MACHINE_PWM_IDS
     MACHINE_PWM_IDS
 #endif
@@ -10,16 +10,22 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "py/runtime.h"
 #include "py/nlr.h"
 #include "py/mperrno.h"
 #include "extmod/vfs.h"
+#include "extmod/vfs_fat.h"
+#include "machine_sd.h"
 
 #if MICROPY_MACHINE_SD
 
 #include <ti/drivers/SD.h>
 
+#define SD_BLOCK_SIZE   (512)
+#define SD_CACHE_BLOCKS (8)
+
 typedef struct _machine_sd_obj_t {
     mp_obj_base_t base;
     SD_Handle sd;
@@ -30,31 +36,121 @@ typedef struct _machine_sd_obj_t {
 
 static machine_sd_obj_t sd_obj;
 
+// Single block reads go through a small LRU cache, which holds on to the
+// FAT and directory blocks a filesystem keeps going back to.  Transfers of
+// more blocks go straight to the card as one CMD18/CMD25, which the SPI
+// driver moves by DMA.  Writes go through to the card, updating any copy
+// held here.
+typedef struct _sd_cache_tag_t {
+    uint32_t block;
+    uint32_t last_used; // 0 if the slot is empty
+} sd_cache_tag_t;
+
+static sd_cache_tag_t sd_cache_tag[SD_CACHE_BLOCKS];
+static uint8_t sd_cache_mem[SD_CACHE_BLOCKS][SD_BLOCK_SIZE] __attribute__((aligned(4)));
+static uint32_t sd_cache_clock;
+
+static void sd_cache_invalidate(void) {
+    memset(sd_cache_tag, 0, sizeof(sd_cache_tag));
+    sd_cache_clock = 0;
+}
+
+static uint8_t *sd_cache_get(uint32_t block) {
+    int lru = 0;
+    for (int i = 0; i < SD_CACHE_BLOCKS; i++) {
+        if (sd_cache_tag[i].last_used && sd_cache_tag[i].block == block) {
+            sd_cache_tag[i].last_used = ++sd_cache_clock;
+            return sd_cache_mem[i];
+        }
+        if (sd_cache_tag[i].last_used < sd_cache_tag[lru].last_used) {
+            lru = i;
+        }
+    }
+
+    if (SD_read(sd_obj.sd, sd_cache_mem[lru], block, 1) != SD_STATUS_SUCCESS) {
+        sd_cache_tag[lru].last_used = 0;
+        return NULL;
+    }
+    sd_cache_tag[lru].block = block;
+    sd_cache_tag[lru].last_used = ++sd_cache_clock;
+    return sd_cache_mem[lru];
+}
+
 void machine_sd_teardown(void) {
     if (sd_obj.sd) {
         SD_close(sd_obj.sd);
         sd_obj.sd = NULL;
     }
+    sd_cache_invalidate();
+}
+
+// Opens SD instance id and brings up the card in it, returning false if
+// there is no card.
+bool machine_sd_open(uint8_t id) {
+    if (sd_obj.sd && sd_obj.id == id) {
+        return true;
+    }
+    machine_sd_teardown();
+
+    if (!(sd_obj.sd = SD_open(id, NULL))) {
+        return false;
+    }
+    if (SD_initialize(sd_obj.sd) != SD_STATUS_SUCCESS
+        || SD_getSectorSize(sd_obj.sd) != SD_BLOCK_SIZE) {
+        machine_sd_teardown();
+        return false;
+    }
+    sd_obj.base.type = &machine_sd_type;
+    sd_obj.id = id;
+    sd_obj.numSectors = SD_getNumSectors(sd_obj.sd);
+    sd_obj.sectorSize = SD_BLOCK_SIZE;
+    return true;
+}
+
+mp_uint_t machine_sd_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks) {
+    if (sd_obj.sd == NULL) {
+        return 1;
+    }
+    if (num_blocks == 1) {
+        uint8_t *src = sd_cache_get(block_num);
+        if (src == NULL) {
+            return 1;
+        }
+        memcpy(dest, src, SD_BLOCK_SIZE);
+        return 0;
+    }
+    // cached blocks are never newer than the card, so can be ignored
+    return SD_read(sd_obj.sd, dest, block_num, num_blocks) != SD_STATUS_SUCCESS;
+}
+
+mp_uint_t machine_sd_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks) {
+    if (sd_obj.sd == NULL) {
+        return 1;
+    }
+    bool ok = SD_write(sd_obj.sd, src, block_num, num_blocks) == SD_STATUS_SUCCESS;
+    for (int i = 0; i < SD_CACHE_BLOCKS; i++) {
+        uint32_t offset = sd_cache_tag[i].block - block_num;
+        if (sd_cache_tag[i].last_used && offset < num_blocks) {
+            if (ok) {
+                memcpy(sd_cache_mem[i], src + offset * SD_BLOCK_SIZE, SD_BLOCK_SIZE);
+            } else {
+                // the card may hold either version now
+                sd_cache_tag[i].last_used = 0;
+            }
+        }
+    }
+    return !ok;
 }
 
 STATIC mp_obj_t machine_sd_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
     mp_int_t id = mp_obj_get_int(args[0]);
     // kwargs not handled
-    machine_sd_obj_t *self = &sd_obj; // m_new_obj(machine_sd_obj_t);
-    self->base.type = type;
-
-    if ((self->sd = SD_open(id, NULL))) {
-        self->id = id;
-        SD_initialize(self->sd);
-        self->numSectors = SD_getNumSectors(self->sd);
-        self->sectorSize = SD_getSectorSize(self->sd);
-    }
-    else {
+    if (!machine_sd_open(id)) {
         mp_raise_OSError(MP_ENODEV);
     }
 
-    return MP_OBJ_FROM_PTR(self);
+    return MP_OBJ_FROM_PTR(&sd_obj);
 }
 
 STATIC void machine_sd_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
@@ -91,7 +187,6 @@ STATIC mp_obj_t machine_sd_readblocks(mp_obj_t self_in, mp_obj_t offset_in, mp_o
 
     if (alloc_buf) {
         len = mp_obj_get_int(len_or_buf);
-        buf = m_new(byte, len);
     }
     else {
         mp_buffer_info_t buf_info;
@@ -99,14 +194,19 @@ STATIC mp_obj_t machine_sd_readblocks(mp_obj_t self_in, mp_obj_t offset_in, mp_o
         len = buf_info.len;
         buf = buf_info.buf;
     }
-
-    int_fast16_t status = SD_read(self->sd, buf, offset,
-                                  len / self->sectorSize);
+    if (len % self->sectorSize) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError,
+                                           "len must be multiple of block size"));
+    }
+    if (alloc_buf) {
+        buf = m_new(byte, len);
+    }
 
     mp_obj_t result = mp_const_none;
-    if (status == SD_STATUS_SUCCESS) {
+    if (machine_sd_read_blocks(buf, offset, len / self->sectorSize) == 0) {
         if (alloc_buf) {
             result = mp_obj_new_bytes(buf, len);
+            m_del(byte, buf, len);
         }
     }
     else {
@@ -136,15 +236,12 @@ STATIC mp_obj_t machine_sd_writeblocks(mp_obj_t self_in, mp_obj_t offset_in, mp_
     mp_buffer_info_t buf_info;
     mp_get_buffer_raise(buf_in, &buf_info, MP_BUFFER_READ);
 
-    if (buf_info.len & 0x3) {
+    if (buf_info.len % self->sectorSize) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError,
-                                           "len must be multiple of 4"));
+                                           "len must be multiple of block size"));
     }
 
-    int_fast16_t status = SD_write(self->sd, buf_info.buf, offset,
-                                   buf_info.len / self->sectorSize);
-
-    if (status != SD_STATUS_SUCCESS) {
+    if (machine_sd_write_blocks(buf_info.buf, offset, buf_info.len / self->sectorSize) != 0) {
         mp_raise_OSError(MP_EIO);
     }
 
@@ -167,7 +264,11 @@ STATIC mp_obj_t machine_sd_ioctl(size_t n_args, const mp_obj_t *args) {
             result = MP_OBJ_NEW_SMALL_INT(self->sectorSize);
             break;
         case BP_IOCTL_INIT:
+            result = MP_OBJ_NEW_SMALL_INT(self->sd == NULL);
+            break;
         case BP_IOCTL_DEINIT:
+            sd_cache_invalidate();
+            break;
         case BP_IOCTL_SYNC:
         default:
             break;
@@ -178,6 +279,23 @@ STATIC mp_obj_t machine_sd_ioctl(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(machine_sd_ioctl_obj, 2, machine_sd_ioctl);
 
+// Sets up a FAT vfs on the card opened by machine_sd_open(), reading and
+// writing it natively.
+void machine_sd_init_vfs(fs_user_mount_t *vfs, int part) {
+    vfs->base.type = &mp_fat_vfs_type;
+    vfs->flags |= FSUSER_NATIVE | FSUSER_HAVE_IOCTL;
+    vfs->fatfs.drv = vfs;
+    vfs->fatfs.part = part;
+    vfs->readblocks[0] = (mp_obj_t)&machine_sd_readblocks_obj;
+    vfs->readblocks[1] = (mp_obj_t)&sd_obj;
+    vfs->readblocks[2] = (mp_obj_t)machine_sd_read_blocks; // native version
+    vfs->writeblocks[0] = (mp_obj_t)&machine_sd_writeblocks_obj;
+    vfs->writeblocks[1] = (mp_obj_t)&sd_obj;
+    vfs->writeblocks[2] = (mp_obj_t)machine_sd_write_blocks; // native version
+    vfs->u.ioctl[0] = (mp_obj_t)&machine_sd_ioctl_obj;
+    vfs->u.ioctl[1] = (mp_obj_t)&sd_obj;
+}
+
 STATIC const mp_rom_map_elem_t machine_sd_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_sd_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_sd_deinit_obj) },
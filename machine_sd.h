@@ -5,6 +5,12 @@
 extern const mp_obj_type_t machine_sd_type;
 extern void machine_sd_teardown(void);
 
+struct _fs_user_mount_t;
+bool machine_sd_open(uint8_t id);
+mp_uint_t machine_sd_read_blocks(uint8_t *dest, uint32_t block_num, uint32_t num_blocks);
+mp_uint_t machine_sd_write_blocks(const uint8_t *src, uint32_t block_num, uint32_t num_blocks);
+void machine_sd_init_vfs(struct _fs_user_mount_t *vfs, int part);
+
 #define MACHINE_SD_CLASS { MP_ROM_QSTR(MP_QSTR_SD), MP_ROM_PTR(&machine_sd_type) },
 #define MACHINE_SD_TEARDOWN() machine_sd_teardown()
 #else
@@ -12,4 +18,11 @@ extern void machine_sd_teardown(void);
 #define MACHINE_SD_TEARDOWN()
 #endif
 
+// A card in SD instance MICROPY_HW_SD is mounted on /sd at boot
+#if MICROPY_MACHINE_SD && defined(MICROPY_HW_SD)
+#define MICROPY_HW_HAS_SDCARD (1)
+#else
+#define MICROPY_HW_HAS_SDCARD (0)
+#endif
+
 #endif
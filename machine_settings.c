@@ -0,0 +1,415 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+// machine.Settings: a small key-value store in the on-chip EEPROM.
+//
+// The EEPROM above SETTINGS_START is split into two banks.  One bank is
+// active at a time; its first word holds a magic byte and a 24-bit
+// sequence number, and the bank with the valid header and the newer
+// sequence wins.  Records are appended behind the header:
+//
+//     hdr   marker:4 | int_key:1 | type:3 | value_len:12 | key_len:8
+//     crc   CRC-32 of the bank header, hdr, key and value
+//     key and value bytes, zero padded to a word
+//
+// The last record for a key is its value; a DELETED record removes it.
+// The log ends at the first word that isn't a valid record.  The CRC is
+// seeded with the bank header, so records left over from the last time the
+// bank was used never pass, and a record cut short by a reset is simply
+// the end of the log.  Writes therefore never need an erase and are
+// atomic.
+//
+// When the active bank fills up the live records are copied into the
+// other bank and its header is written last, which switches banks in one
+// word write.  Writes walk through both banks in turn, spreading wear
+// over the whole region.
+//
+// No state is kept between calls; every operation reads the headers and
+// walks the log, so raw EEPROM() writes or erase() can't leave it stale.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+
+#if MICROPY_MACHINE_TI_EEPROM
+
+#include <ti/devices/msp432e4/driverlib/eeprom.h>
+
+#include "machine_eeprom.h"
+#include "machine_settings.h"
+
+#define SETTINGS_START      (1024)  // bytes below this are left to EEPROM()
+#define SETTINGS_MAGIC      (0x5e)
+#define SEQ_MASK            (0xffffff)
+
+#define REC_MARKER          (0x5)
+#define REC_KEY_MAX         (32)
+#define REC_VALUE_MAX       (256)
+
+enum { VAL_BYTES, VAL_STR, VAL_INT, VAL_DELETED };
+
+#define REC_HDR(klen, vlen, type, int_key) \
+    ((REC_MARKER << 28) | ((int_key) << 27) | ((type) << 24) | ((vlen) << 8) | (klen))
+#define REC_MARKER_OF(h)    ((h) >> 28)
+#define REC_INT_KEY(h)      (((h) >> 27) & 1)
+#define REC_TYPE(h)         (((h) >> 24) & 7)
+#define REC_VLEN(h)         (((h) >> 8) & 0xfff)
+#define REC_KLEN(h)         ((h) & 0xff)
+#define REC_BYTES(h)        (8 + ((REC_KLEN(h) + REC_VLEN(h) + 3) & ~3))
+
+// key fields of a header, for matching
+#define REC_KEY_BITS(h)     ((h) & ((1 << 27) | 0xff))
+
+typedef struct _settings_rec_t {
+    uint32_t hdr;
+    uint32_t crc;
+    uint32_t data[(REC_KEY_MAX + REC_VALUE_MAX) / 4];
+} settings_rec_t;
+
+typedef struct _settings_log_t {
+    uint32_t base;      // EEPROM address of the active bank
+    uint32_t bank_hdr;  // its header word
+    uint32_t end;       // offset of the first free byte in the bank
+} settings_log_t;
+
+typedef struct _machine_settings_obj_t {
+    mp_obj_base_t base;
+} machine_settings_obj_t;
+
+STATIC const machine_settings_obj_t machine_settings_obj = {{&machine_settings_type}};
+
+STATIC uint32_t settings_bank_size(void) {
+    return ((EEPROMSizeGet() - SETTINGS_START) / 2) & ~3;
+}
+
+STATIC void settings_program(const void *buf, uint32_t addr, uint32_t len) {
+    if (EEPROMProgram((uint32_t *)buf, addr, len)) {
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+STATIC uint32_t crc32_update(uint32_t crc, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+STATIC uint32_t rec_crc(uint32_t bank_hdr, const settings_rec_t *rec) {
+    uint32_t crc = crc32_update(0xffffffff, &bank_hdr, 4);
+    crc = crc32_update(crc, &rec->hdr, 4);
+    crc = crc32_update(crc, rec->data, REC_BYTES(rec->hdr) - 8);
+    return ~crc;
+}
+
+STATIC bool rec_hdr_valid(uint32_t hdr, uint32_t off, uint32_t bank_size) {
+    return REC_MARKER_OF(hdr) == REC_MARKER
+        && REC_KLEN(hdr) >= 1 && REC_KLEN(hdr) <= REC_KEY_MAX
+        && REC_VLEN(hdr) <= REC_VALUE_MAX
+        && off + REC_BYTES(hdr) <= bank_size;
+}
+
+// Reads the record at off into rec; false at the end of the log.
+STATIC bool rec_read(const settings_log_t *log, uint32_t off, settings_rec_t *rec) {
+    uint32_t bank_size = settings_bank_size();
+    if (off + 8 > bank_size) {
+        return false;
+    }
+    EEPROMRead(&rec->hdr, log->base + off, 8);
+    if (!rec_hdr_valid(rec->hdr, off, bank_size)) {
+        return false;
+    }
+    EEPROMRead(rec->data, log->base + off + 8, REC_BYTES(rec->hdr) - 8);
+    return rec->crc == rec_crc(log->bank_hdr, rec);
+}
+
+STATIC bool seq_newer(uint32_t a, uint32_t b) {
+    uint32_t diff = (a - b) & SEQ_MASK;
+    return diff != 0 && diff < (SEQ_MASK + 1) / 2;
+}
+
+// Finds the active bank and the end of its log, formatting bank 0 if
+// neither bank has been set up.
+STATIC void settings_mount(settings_log_t *log) {
+    machine_eeprom_init();
+
+    uint32_t bank_size = settings_bank_size();
+    uint32_t hdr[2];
+    EEPROMRead(&hdr[0], SETTINGS_START, 4);
+    EEPROMRead(&hdr[1], SETTINGS_START + bank_size, 4);
+    bool valid[2] = { (hdr[0] >> 24) == SETTINGS_MAGIC, (hdr[1] >> 24) == SETTINGS_MAGIC };
+
+    int bank;
+    if (valid[0] && valid[1]) {
+        bank = seq_newer(hdr[1], hdr[0]) ? 1 : 0;
+    } else if (valid[0] || valid[1]) {
+        bank = valid[1] ? 1 : 0;
+    } else {
+        bank = 0;
+        hdr[0] = (SETTINGS_MAGIC << 24) | 1;
+        settings_program(&hdr[0], SETTINGS_START, 4);
+    }
+
+    log->base = SETTINGS_START + bank * bank_size;
+    log->bank_hdr = hdr[bank];
+
+    settings_rec_t rec;
+    uint32_t off = 4;
+    while (rec_read(log, off, &rec)) {
+        off += REC_BYTES(rec.hdr);
+    }
+    log->end = off;
+}
+
+STATIC bool key_matches(const settings_rec_t *rec, uint32_t key_hdr, const void *key) {
+    return REC_KEY_BITS(rec->hdr) == REC_KEY_BITS(key_hdr)
+        && memcmp(rec->data, key, REC_KLEN(key_hdr)) == 0;
+}
+
+// Leaves the newest record for the key in rec; false if there is none or
+// it has been deleted.
+STATIC bool settings_find(const settings_log_t *log, const settings_rec_t *key, settings_rec_t *rec) {
+    settings_rec_t cur;
+    bool found = false;
+    for (uint32_t off = 4; off < log->end; off += REC_BYTES(cur.hdr)) {
+        rec_read(log, off, &cur);
+        if (key_matches(&cur, key->hdr, key->data)) {
+            *rec = cur;
+            found = true;
+        }
+    }
+    return found && REC_TYPE(rec->hdr) != VAL_DELETED;
+}
+
+// Reads the whole log into the heap, for the operations that need to look
+// at every record against every other.
+STATIC uint32_t *settings_load(const settings_log_t *log) {
+    uint32_t *img = m_new(uint32_t, log->end / 4);
+    EEPROMRead(img, log->base, log->end);
+    return img;
+}
+
+STATIC settings_rec_t *img_rec(uint32_t *img, uint32_t off) {
+    return (settings_rec_t *)((byte *)img + off);
+}
+
+// True if the record at off holds the current value of its key.
+STATIC bool img_live(uint32_t *img, uint32_t off, uint32_t end) {
+    settings_rec_t *rec = img_rec(img, off);
+    if (REC_TYPE(rec->hdr) == VAL_DELETED) {
+        return false;
+    }
+    for (uint32_t later = off + REC_BYTES(rec->hdr); later < end; later += REC_BYTES(img_rec(img, later)->hdr)) {
+        if (key_matches(img_rec(img, later), rec->hdr, rec->data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies the live records into the other bank, then switches to it.
+STATIC void settings_compact(settings_log_t *log) {
+    uint32_t bank_size = settings_bank_size();
+    uint32_t new_base = log->base == SETTINGS_START ? SETTINGS_START + bank_size : SETTINGS_START;
+    uint32_t new_hdr = (SETTINGS_MAGIC << 24) | ((log->bank_hdr + 1) & SEQ_MASK);
+
+    uint32_t *img = settings_load(log);
+    uint32_t out = 4;
+    for (uint32_t off = 4; off < log->end; off += REC_BYTES(img_rec(img, off)->hdr)) {
+        if (img_live(img, off, log->end)) {
+            settings_rec_t *rec = img_rec(img, off);
+            uint32_t len = REC_BYTES(rec->hdr);
+            rec->crc = rec_crc(new_hdr, rec);
+            settings_program(rec, new_base + out, len);
+            out += len;
+        }
+    }
+    m_del(uint32_t, img, log->end / 4);
+
+    // the switch: until this word lands the old bank stays active
+    settings_program(&new_hdr, new_base, 4);
+
+    log->base = new_base;
+    log->bank_hdr = new_hdr;
+    log->end = out;
+}
+
+STATIC void settings_append(settings_log_t *log, settings_rec_t *rec) {
+    uint32_t len = REC_BYTES(rec->hdr);
+    if (log->end + len > settings_bank_size()) {
+        settings_compact(log);
+        if (log->end + len > settings_bank_size()) {
+            mp_raise_OSError(MP_ENOSPC);
+        }
+    }
+    rec->crc = rec_crc(log->bank_hdr, rec);
+    settings_program(rec, log->base + log->end, len);
+    log->end += len;
+}
+
+// Fills in the key fields of rec from a str, bytes or int key.
+STATIC void settings_key(mp_obj_t key_in, settings_rec_t *rec) {
+    memset(rec, 0, sizeof(*rec));
+    if (MP_OBJ_IS_INT(key_in)) {
+        int32_t key = mp_obj_get_int(key_in);
+        memcpy(rec->data, &key, 4);
+        rec->hdr = REC_HDR(4, 0, 0, 1);
+        return;
+    }
+    size_t len;
+    const char *key = mp_obj_str_get_data(key_in, &len);
+    if (len < 1 || len > REC_KEY_MAX) {
+        mp_raise_ValueError("key must be 1-32 bytes");
+    }
+    memcpy(rec->data, key, len);
+    rec->hdr = REC_HDR(len, 0, 0, 0);
+}
+
+STATIC mp_obj_t machine_settings_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 0, false);
+    machine_eeprom_init();
+    return MP_OBJ_FROM_PTR(&machine_settings_obj);
+}
+
+/* get(key, default=None) -> the stored bytes, str or int */
+STATIC mp_obj_t machine_settings_get(size_t n_args, const mp_obj_t *args) {
+    settings_log_t log;
+    settings_mount(&log);
+
+    settings_rec_t key, rec;
+    settings_key(args[1], &key);
+    if (!settings_find(&log, &key, &rec)) {
+        return n_args > 2 ? args[2] : mp_const_none;
+    }
+
+    const byte *value = (const byte *)rec.data + REC_KLEN(rec.hdr);
+    size_t len = REC_VLEN(rec.hdr);
+    switch (REC_TYPE(rec.hdr)) {
+        case VAL_STR:
+            return mp_obj_new_str((const char *)value, len);
+        case VAL_INT: {
+            int32_t val;
+            memcpy(&val, value, 4);
+            return mp_obj_new_int(val);
+        }
+        default:
+            return mp_obj_new_bytes(value, len);
+    }
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_settings_get_obj, 2, 3, machine_settings_get);
+
+/* set(key, value) -> store bytes, str or an int; None deletes the key */
+STATIC mp_obj_t machine_settings_set(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
+    settings_rec_t rec;
+    settings_key(key_in, &rec);
+    size_t klen = REC_KLEN(rec.hdr);
+    byte *value = (byte *)rec.data + klen;
+
+    int type;
+    size_t len;
+    if (value_in == mp_const_none) {
+        type = VAL_DELETED;
+        len = 0;
+    } else if (MP_OBJ_IS_INT(value_in)) {
+        int32_t val = mp_obj_get_int(value_in);
+        memcpy(value, &val, 4);
+        type = VAL_INT;
+        len = 4;
+    } else {
+        type = MP_OBJ_IS_STR(value_in) ? VAL_STR : VAL_BYTES;
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(value_in, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len > REC_VALUE_MAX) {
+            mp_raise_ValueError("value too long");
+        }
+        memcpy(value, bufinfo.buf, bufinfo.len);
+        len = bufinfo.len;
+    }
+    rec.hdr = REC_HDR(klen, len, type, REC_INT_KEY(rec.hdr));
+
+    settings_log_t log;
+    settings_mount(&log);
+
+    // rewriting the same value costs nothing
+    settings_rec_t old;
+    bool found = settings_find(&log, &rec, &old);
+    if (type == VAL_DELETED ? !found
+        : found && old.hdr == rec.hdr && memcmp(old.data, rec.data, REC_BYTES(rec.hdr) - 8) == 0) {
+        return mp_const_none;
+    }
+
+    settings_append(&log, &rec);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_settings_set_obj, machine_settings_set);
+
+/* keys() -> list of the stored keys */
+STATIC mp_obj_t machine_settings_keys(mp_obj_t self_in) {
+    settings_log_t log;
+    settings_mount(&log);
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint32_t *img = settings_load(&log);
+    for (uint32_t off = 4; off < log.end; off += REC_BYTES(img_rec(img, off)->hdr)) {
+        if (!img_live(img, off, log.end)) {
+            continue;
+        }
+        settings_rec_t *rec = img_rec(img, off);
+        mp_obj_t key;
+        if (REC_INT_KEY(rec->hdr)) {
+            int32_t val;
+            memcpy(&val, rec->data, 4);
+            key = mp_obj_new_int(val);
+        } else {
+            key = mp_obj_new_str((const char *)rec->data, REC_KLEN(rec->hdr));
+        }
+        mp_obj_list_append(list, key);
+    }
+    m_del(uint32_t, img, log.end / 4);
+    return list;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_settings_keys_obj, machine_settings_keys);
+
+/* clear() -> drop every key, by switching to an empty bank */
+STATIC mp_obj_t machine_settings_clear(mp_obj_t self_in) {
+    settings_log_t log;
+    settings_mount(&log);
+    log.end = 4;
+    settings_compact(&log);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_settings_clear_obj, machine_settings_clear);
+
+STATIC const mp_rom_map_elem_t machine_settings_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&machine_settings_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set), MP_ROM_PTR(&machine_settings_set_obj) },
+    { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&machine_settings_keys_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&machine_settings_clear_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(machine_settings_locals_dict, machine_settings_locals_dict_table);
+
+const mp_obj_type_t machine_settings_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Settings,
+    .make_new = machine_settings_make_new,
+    .locals_dict = (mp_obj_dict_t*)&machine_settings_locals_dict,
+};
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef MACHINE_SETTINGS_H_INC
+#define MACHINE_SETTINGS_H_INC
+
+#if MICROPY_MACHINE_TI_EEPROM
+extern const mp_obj_type_t machine_settings_type;
+
+#define MACHINE_SETTINGS_CLASS { MP_ROM_QSTR(MP_QSTR_Settings), MP_ROM_PTR(&machine_settings_type) },
+#else
+#define MACHINE_SETTINGS_CLASS
+#endif
+
+#endif
@@ -14,7 +14,40 @@
 #include "py/runtime.h"
 #include "py/mperrno.h"
 
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
 #include <ti/drivers/SPI.h>
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "machine_pin.h"
+
+// The driver is always opened in callback mode and every transfer goes
+// through a small per-bus queue, which the SPI callback works through
+// back to back, framing each one with its own CS pin if it has one.  The
+// blocking methods queue a transfer and wait for it; the _async ones
+// return at once and schedule callback(buf) when their transfer is done.
+//
+// The queue is GC-allocated and hangs off machine_spi_queue[] so the
+// buffers and callbacks of transfers in flight stay alive.
+
+#define SPI_QUEUE_LEN (8)
+#define CS_NONE (~0u)
+
+typedef struct _spi_job_t {
+    SPI_Transaction trans;
+    uint32_t cs;
+    mp_obj_t buf;           // what the callback gets
+    mp_obj_t other;         // the other buffer of a write_readinto
+    mp_obj_t callback;
+} spi_job_t;
+
+typedef struct _spi_queue_t {
+    spi_job_t job[SPI_QUEUE_LEN];
+    volatile uint32_t submitted;
+    volatile uint32_t completed;
+} spi_queue_t;
 
 typedef struct _machine_spi_obj_t {
     mp_obj_base_t base;
@@ -24,6 +57,7 @@ typedef struct _machine_spi_obj_t {
     uint8_t polarity;
     uint8_t phase;
     uint8_t bits;
+    Semaphore_Handle done;
 } machine_spi_obj_t;
 
 extern const mp_obj_type_t machine_spi_type;
@@ -36,12 +70,125 @@ static machine_spi_obj_t spi_obj[NUM_SPI] = {
     {{&machine_spi_type}, .id = 2, .baudrate = 1000000, .polarity = 0, .phase = 0, .bits = 8},
 };
 
+#define SPI_QUEUE(self) ((spi_queue_t *)MP_STATE_PORT(machine_spi_queue)[(self)->id])
+
 void machine_spi_teardown(void) {
     for (int i = 0; i < NUM_SPI; i++) {
+        // the callback ignores a bus with no queue, cancelling included
+        MP_STATE_PORT(machine_spi_queue)[i] = NULL;
         if (spi_obj[i].spi) {
+            SPI_transferCancel(spi_obj[i].spi);
             SPI_close(spi_obj[i].spi);
             spi_obj[i].spi = NULL;
         }
+        if (spi_obj[i].done) {
+            Semaphore_delete(&spi_obj[i].done);
+        }
+    }
+}
+
+// Finish off the head of the queue.
+STATIC void spi_job_done(spi_queue_t *queue) {
+    spi_job_t *job = &queue->job[queue->completed % SPI_QUEUE_LEN];
+    if (job->cs != CS_NONE) {
+        GPIO_write(job->cs, 1);
+    }
+    if (job->callback != mp_const_none) {
+        mp_sched_schedule(job->callback, job->buf);
+    }
+    job->buf = job->other = job->callback = mp_const_none;
+    queue->completed++;
+}
+
+// Start the head of the queue.  A transfer the driver refuses never gets
+// its callback, so it is finished here and the next one tried.
+STATIC void spi_start(machine_spi_obj_t *self, spi_queue_t *queue) {
+    while (queue->completed != queue->submitted) {
+        spi_job_t *job = &queue->job[queue->completed % SPI_QUEUE_LEN];
+        if (job->cs != CS_NONE) {
+            GPIO_write(job->cs, 0);
+        }
+        if (SPI_transfer(self->spi, &job->trans)) {
+            return;
+        }
+        spi_job_done(queue);
+        Semaphore_post(self->done);
+    }
+}
+
+// Runs in the SPI interrupt: finish off the head of the queue and start
+// the next transfer straight away.
+STATIC void spi_callback(SPI_Handle handle, SPI_Transaction *trans) {
+    machine_spi_obj_t *self = NULL;
+    for (int i = 0; i < NUM_SPI; i++) {
+        if (spi_obj[i].spi == handle) {
+            self = &spi_obj[i];
+            break;
+        }
+    }
+    spi_queue_t *queue = self ? SPI_QUEUE(self) : NULL;
+    if (queue == NULL || queue->completed == queue->submitted) {
+        return;
+    }
+
+    spi_job_done(queue);
+    spi_start(self, queue);
+    Semaphore_post(self->done);
+}
+
+// Wait until at most pending transfers are still queued.
+STATIC void spi_wait(machine_spi_obj_t *self, uint32_t pending) {
+    spi_queue_t *queue = SPI_QUEUE(self);
+    while (queue->submitted - queue->completed > pending) {
+        Semaphore_pend(self->done, BIOS_WAIT_FOREVER);
+    }
+}
+
+// Queue a transfer, starting it if the bus is idle.  Returns its sequence
+// number for spi_wait_for.
+STATIC uint32_t spi_submit(machine_spi_obj_t *self, size_t len, const void *src, void *dest,
+    mp_obj_t buf, mp_obj_t other, mp_obj_t cs, mp_obj_t callback) {
+    if (self->spi == NULL) {
+        mp_raise_OSError(MP_EBADF);
+    }
+    uint32_t cs_id = cs == mp_const_none ? CS_NONE : machine_pin_get_id(cs);
+
+    // the driver won't start an empty transfer
+    size_t count = self->bits > 8 && self->bits <= 16 ? len / 2 : len;
+    if (count == 0) {
+        mp_raise_ValueError("buffer too short");
+    }
+
+    // room for one more
+    spi_wait(self, SPI_QUEUE_LEN - 1);
+
+    spi_queue_t *queue = SPI_QUEUE(self);
+    spi_job_t *job = &queue->job[queue->submitted % SPI_QUEUE_LEN];
+    job->trans.txBuf = (void *)src;
+    job->trans.rxBuf = dest;
+    job->trans.count = count;
+    job->trans.arg = NULL;
+    job->cs = cs_id;
+    job->buf = buf;
+    job->other = other;
+    job->callback = callback;
+
+    // otherwise the last transfer could finish between the check and the
+    // increment, and this one would never be started
+    uint32_t key = HwiP_disable();
+    bool idle = queue->submitted == queue->completed;
+    uint32_t seq = ++queue->submitted;
+    HwiP_restore(key);
+    if (idle) {
+        spi_start(self, queue);
+    }
+    return seq;
+}
+
+STATIC void spi_wait_for(machine_spi_obj_t *self, uint32_t seq) {
+    spi_queue_t *queue = SPI_QUEUE(self);
+    while ((int32_t)(queue->completed - seq) < 0) {
+        Semaphore_pend(self->done, BIOS_WAIT_FOREVER);
     }
 }
 
@@ -76,9 +223,30 @@ static void spi_init_helper(machine_spi_obj_t * self, size_t n_args, const mp_ob
     params.bitRate = self->baudrate;
     params.dataSize = self->bits;
     params.frameFormat = (self->polarity << 1) | self->phase;
+    params.transferMode = SPI_MODE_CALLBACK;
+    params.transferCallbackFxn = spi_callback;
 
     if (self->spi) {
+        // let anything queued finish with the old settings
+        spi_wait(self, 0);
         SPI_close(self->spi);
+        self->spi = NULL;
+    }
+
+    if (SPI_QUEUE(self) == NULL) {
+        spi_queue_t *queue = m_new0(spi_queue_t, 1);
+        for (int i = 0; i < SPI_QUEUE_LEN; i++) {
+            queue->job[i].buf = queue->job[i].other = queue->job[i].callback = mp_const_none;
+        }
+        MP_STATE_PORT(machine_spi_queue)[self->id] = queue;
+    }
+    if (self->done == NULL) {
+        Semaphore_Params sem_params;
+        Semaphore_Params_init(&sem_params);
+        sem_params.mode = Semaphore_Mode_BINARY;
+        if ((self->done = Semaphore_create(0, &sem_params, NULL)) == NULL) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
     }
 
     if ((self->spi = SPI_open(self->id, &params)) == NULL) {
@@ -127,17 +295,12 @@ STATIC mp_obj_t machine_spi_deinit(mp_obj_t self_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_spi_deinit_obj, machine_spi_deinit);
 
 static void spi_transfer(machine_spi_obj_t *self, size_t len, const uint8_t *src, void *dest) {
-    SPI_Transaction trans;
-
-    trans.txBuf = (void *)src;
-    trans.rxBuf = dest;
-    if (self->bits > 8 && self->bits <= 16) {
-        trans.count = len / 2;
-    }
-    else {
-        trans.count = len;
+    // nothing to queue, and nothing for the caller to wait for
+    if (len == 0) {
+        return;
     }
-    (void)SPI_transfer(self->spi, &trans);
+    spi_wait_for(self, spi_submit(self, len, src, dest,
+        mp_const_none, mp_const_none, mp_const_none, mp_const_none));
 }
 
 STATIC mp_obj_t machine_spi_read(size_t n_args, const mp_obj_t *args) {
@@ -191,6 +354,88 @@ STATIC mp_obj_t machine_spi_write_readinto(mp_obj_t self_in, mp_obj_t write_buf_
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(machine_spi_write_readinto_obj, machine_spi_write_readinto);
 
+STATIC const mp_arg_t spi_async_args[] = {
+    { MP_QSTR_callback, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    { MP_QSTR_cs, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+};
+enum { ARG_callback, ARG_cs };
+
+/* write_async(buf, callback=None, *, cs=None) -> queue a write */
+STATIC mp_obj_t machine_spi_write_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    machine_spi_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(spi_async_args)];
+    mp_arg_parse_all(n_args - 2, pos_args + 2, kw_args,
+        MP_ARRAY_SIZE(spi_async_args), spi_async_args, args);
+    mp_buffer_info_t buf_info;
+    mp_get_buffer_raise(pos_args[1], &buf_info, MP_BUFFER_READ);
+
+    spi_submit(self, buf_info.len, buf_info.buf, NULL, pos_args[1], mp_const_none,
+        args[ARG_cs].u_obj, args[ARG_callback].u_obj);
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_spi_write_async_obj, 2, machine_spi_write_async);
+
+/* readinto_async(buf, callback=None, *, cs=None) -> queue a read */
+STATIC mp_obj_t machine_spi_readinto_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    machine_spi_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(spi_async_args)];
+    mp_arg_parse_all(n_args - 2, pos_args + 2, kw_args,
+        MP_ARRAY_SIZE(spi_async_args), spi_async_args, args);
+    mp_buffer_info_t buf_info;
+    mp_get_buffer_raise(pos_args[1], &buf_info, MP_BUFFER_WRITE);
+
+    spi_submit(self, buf_info.len, NULL, buf_info.buf, pos_args[1], mp_const_none,
+        args[ARG_cs].u_obj, args[ARG_callback].u_obj);
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_spi_readinto_async_obj, 2, machine_spi_readinto_async);
+
+/* write_readinto_async(wbuf, rbuf, callback=None, *, cs=None) -> callback gets rbuf */
+STATIC mp_obj_t machine_spi_write_readinto_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    machine_spi_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(spi_async_args)];
+    mp_arg_parse_all(n_args - 3, pos_args + 3, kw_args,
+        MP_ARRAY_SIZE(spi_async_args), spi_async_args, args);
+    mp_buffer_info_t write_buf_info;
+    mp_get_buffer_raise(pos_args[1], &write_buf_info, MP_BUFFER_READ);
+    mp_buffer_info_t read_buf_info;
+    mp_get_buffer_raise(pos_args[2], &read_buf_info, MP_BUFFER_WRITE);
+    if (write_buf_info.len != read_buf_info.len) {
+        mp_raise_ValueError("buffers must be the same length");
+    }
+
+    spi_submit(self, read_buf_info.len, write_buf_info.buf, read_buf_info.buf,
+        pos_args[2], pos_args[1], args[ARG_cs].u_obj, args[ARG_callback].u_obj);
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_spi_write_readinto_async_obj, 3, machine_spi_write_readinto_async);
+
+/* pending() -> number of queued transfers not yet finished */
+STATIC mp_obj_t machine_spi_pending(mp_obj_t self_in) {
+    machine_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    spi_queue_t *queue = SPI_QUEUE(self);
+    return MP_OBJ_NEW_SMALL_INT(queue ? queue->submitted - queue->completed : 0);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_spi_pending_obj, machine_spi_pending);
+
+/* wait() -> block until every queued transfer has finished */
+STATIC mp_obj_t machine_spi_wait(mp_obj_t self_in) {
+    machine_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (SPI_QUEUE(self)) {
+        spi_wait(self, 0);
+    }
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_spi_wait_obj, machine_spi_wait);
+
 STATIC const mp_rom_map_elem_t machine_spi_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_spi_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_spi_deinit_obj) },
@@ -198,6 +443,11 @@ STATIC const mp_rom_map_elem_t machine_spi_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&machine_spi_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&machine_spi_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_write_readinto), MP_ROM_PTR(&machine_spi_write_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&machine_spi_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto_async), MP_ROM_PTR(&machine_spi_readinto_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_readinto_async), MP_ROM_PTR(&machine_spi_write_readinto_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pending), MP_ROM_PTR(&machine_spi_pending_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&machine_spi_wait_obj) },
     { MP_ROM_QSTR(MP_QSTR_MASTER), MP_ROM_INT(3) },
     { MP_ROM_QSTR(MP_QSTR_MSB), MP_ROM_INT(0) },
     { MP_ROM_QSTR(MP_QSTR_LSB), MP_ROM_INT(1) },
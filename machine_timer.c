@@ -0,0 +1,349 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/gc.h"
+#include "py/stackctrl.h"
+
+#include <ti/sysbios/BIOS.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
+
+#include "ti/devices/msp432e4/driverlib/driverlib.h"
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerMSP432E4.h>
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "modmachine.h"
+
+// Timer(id) drives one of the general purpose timers as a 32-bit down
+// counter clocked from the system clock, so periods are exact to the
+// cycle.  TIMER0-1 are left to SYS/BIOS (Clock and Timestamp), TIMER2
+// triggers ADCBuf sampling and TIMER3 belongs to the neopixels (lent to
+// PWM.play() between frames), which leaves these:
+//
+//     Timer(0..3) -> TIMER4..TIMER7
+//
+// Soft callbacks are queued with mp_sched_schedule.  Hard callbacks run in
+// the interrupt itself with the heap locked, on the system stack (STACKSIZE
+// in the .lds), so they must not allocate.  Console output can block, so
+// an exception in one is kept and printed from a scheduled callback.
+
+#define MODE_ONE_SHOT   (0)
+#define MODE_PERIODIC   (1)
+
+// headroom left on the system stack below a hard callback
+#define HARD_STACK_LIMIT    (3 * 1024)
+
+typedef struct _machine_timer_obj_t {
+    mp_obj_base_t base;
+    uint8_t id;
+    uint8_t mode;
+    bool hard;
+    bool running;
+    uint32_t base_addr;
+    uint32_t periph;
+    uint32_t power_id;
+    uint32_t int_num;
+    HwiP_Handle hwi;
+    uint32_t load;          // cycles per period
+
+    // interval statistics, in Timestamp ticks
+    uint32_t last_stamp;
+    uint32_t count;
+    uint32_t missed;        // soft callbacks dropped with the queue full
+    uint32_t min_interval;
+    uint32_t max_interval;
+} machine_timer_obj_t;
+
+extern const mp_obj_type_t machine_timer_type;
+
+#define NUM_TIMER 4
+static machine_timer_obj_t timer_obj[NUM_TIMER] = {
+    {{&machine_timer_type}, .id = 0, .base_addr = TIMER4_BASE, .periph = SYSCTL_PERIPH_TIMER4,
+        .power_id = PowerMSP432E4_PERIPH_TIMER4, .int_num = INT_TIMER4A},
+    {{&machine_timer_type}, .id = 1, .base_addr = TIMER5_BASE, .periph = SYSCTL_PERIPH_TIMER5,
+        .power_id = PowerMSP432E4_PERIPH_TIMER5, .int_num = INT_TIMER5A},
+    {{&machine_timer_type}, .id = 2, .base_addr = TIMER6_BASE, .periph = SYSCTL_PERIPH_TIMER6,
+        .power_id = PowerMSP432E4_PERIPH_TIMER6, .int_num = INT_TIMER6A},
+    {{&machine_timer_type}, .id = 3, .base_addr = TIMER7_BASE, .periph = SYSCTL_PERIPH_TIMER7,
+        .power_id = PowerMSP432E4_PERIPH_TIMER7, .int_num = INT_TIMER7A},
+};
+
+static uint32_t cpu_freq;
+static uint32_t stamp_freq;
+
+static void timer_stop(machine_timer_obj_t *self) {
+    if (self->hwi) {
+        MAP_TimerIntDisable(self->base_addr, TIMER_TIMA_TIMEOUT);
+        MAP_TimerDisable(self->base_addr, TIMER_A);
+        MAP_TimerIntClear(self->base_addr, TIMER_TIMA_TIMEOUT);
+    }
+    self->running = false;
+}
+
+void machine_timer_teardown(void) {
+    for (int i = 0; i < NUM_TIMER; i++) {
+        timer_stop(&timer_obj[i]);
+        MP_STATE_PORT(machine_timer_callback)[i] = mp_const_none;
+        MP_STATE_PORT(machine_timer_error)[i] = MP_OBJ_NULL;
+    }
+}
+
+STATIC mp_obj_t timer_report(mp_obj_t self_in) {
+    machine_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t exc = MP_STATE_PORT(machine_timer_error)[self->id];
+    MP_STATE_PORT(machine_timer_error)[self->id] = MP_OBJ_NULL;
+    if (exc != MP_OBJ_NULL) {
+        mp_printf(&mp_plat_print, "uncaught exception in Timer(%u) callback\n", self->id);
+        mp_obj_print_exception(&mp_plat_print, exc);
+    }
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(timer_report_obj, timer_report);
+
+static void timer_call_hard(machine_timer_obj_t *self, mp_obj_t cb) {
+    // the VM's stack checks are relative to the MicroPython task's stack,
+    // so point them at the system stack for the duration
+    char *stack_top = MP_STATE_THREAD(stack_top);
+    size_t stack_limit = MP_STATE_THREAD(stack_limit);
+    volatile int stack_dummy;
+    mp_stack_set_top((char *)&stack_dummy);
+    mp_stack_set_limit(HARD_STACK_LIMIT);
+
+    mp_sched_lock();
+    gc_lock();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_call_function_1(cb, MP_OBJ_FROM_PTR(self));
+        nlr_pop();
+    } else {
+        // an exception stops the timer rather than firing it again
+        timer_stop(self);
+        MP_STATE_PORT(machine_timer_callback)[self->id] = mp_const_none;
+        MP_STATE_PORT(machine_timer_error)[self->id] = MP_OBJ_FROM_PTR(nlr.ret_val);
+        mp_sched_schedule(MP_OBJ_FROM_PTR(&timer_report_obj), MP_OBJ_FROM_PTR(self));
+    }
+    gc_unlock();
+    mp_sched_unlock();
+
+    MP_STATE_THREAD(stack_top) = stack_top;
+    MP_STATE_THREAD(stack_limit) = stack_limit;
+}
+
+static void timer_isr(uintptr_t arg) {
+    machine_timer_obj_t *self = (machine_timer_obj_t *)arg;
+    uint32_t now = Timestamp_get32();
+
+    MAP_TimerIntClear(self->base_addr, TIMER_TIMA_TIMEOUT);
+
+    if (self->count > 0) {
+        uint32_t interval = now - self->last_stamp;
+        if (interval < self->min_interval) {
+            self->min_interval = interval;
+        }
+        if (interval > self->max_interval) {
+            self->max_interval = interval;
+        }
+    }
+    self->last_stamp = now;
+    self->count++;
+
+    if (self->mode == MODE_ONE_SHOT) {
+        self->running = false;
+    }
+
+    mp_obj_t cb = MP_STATE_PORT(machine_timer_callback)[self->id];
+    if (cb != mp_const_none) {
+        if (self->hard) {
+            timer_call_hard(self, cb);
+        } else if (!mp_sched_schedule(cb, MP_OBJ_FROM_PTR(self))) {
+            self->missed++;
+        }
+    }
+
+    machine_wake(MACHINE_TIMER_WAKE);
+}
+
+static uint32_t stamp_to_us(uint32_t stamp) {
+    return (uint64_t)stamp * 1000000 / stamp_freq;
+}
+
+STATIC void timer_init_helper(machine_timer_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_mode, ARG_freq, ARG_period, ARG_period_us, ARG_callback, ARG_hard };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_mode, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = MODE_PERIODIC} },
+        { MP_QSTR_freq, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_period, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_period_us, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_hard, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args,
+        MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (cpu_freq == 0) {
+        xdc_runtime_Types_FreqHz freq;
+        BIOS_getCpuFreq(&freq);
+        cpu_freq = freq.lo;
+        Timestamp_getFreq(&freq);
+        stamp_freq = freq.lo;
+    }
+
+    uint64_t load;
+    if (args[ARG_freq].u_obj != mp_const_none) {
+        mp_float_t freq = mp_obj_get_float(args[ARG_freq].u_obj);
+        if (freq <= 0) {
+            mp_raise_ValueError("freq must be positive");
+        }
+        load = (uint64_t)(cpu_freq / freq + 0.5);
+    } else if (args[ARG_period_us].u_int >= 0) {
+        load = (uint64_t)args[ARG_period_us].u_int * (cpu_freq / 1000000);
+    } else if (args[ARG_period].u_int >= 0) {
+        load = (uint64_t)args[ARG_period].u_int * (cpu_freq / 1000);
+    } else {
+        mp_raise_ValueError("need freq, period or period_us");
+    }
+    if (load < 2 || load > 0xffffffffu) {
+        mp_raise_ValueError("period out of range");
+    }
+
+    timer_stop(self);
+
+    self->mode = args[ARG_mode].u_int == MODE_ONE_SHOT ? MODE_ONE_SHOT : MODE_PERIODIC;
+    self->hard = args[ARG_hard].u_bool;
+    self->load = load;
+    self->count = 0;
+    self->missed = 0;
+    self->min_interval = UINT32_MAX;
+    self->max_interval = 0;
+    MP_STATE_PORT(machine_timer_callback)[self->id] = args[ARG_callback].u_obj;
+
+    if (self->hwi == NULL) {
+        Power_setDependency(self->power_id);
+        MAP_SysCtlPeripheralEnable(self->periph);
+
+        HwiP_Params params;
+        HwiP_Params_init(&params);
+        params.arg = (uintptr_t)self;
+        params.enableInt = true;
+        if ((self->hwi = HwiP_create(self->int_num, timer_isr, &params)) == NULL) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+
+    MAP_TimerConfigure(self->base_addr,
+        self->mode == MODE_ONE_SHOT ? TIMER_CFG_ONE_SHOT : TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(self->base_addr, TIMER_A, self->load - 1);
+    MAP_TimerIntClear(self->base_addr, TIMER_TIMA_TIMEOUT);
+    MAP_TimerIntEnable(self->base_addr, TIMER_TIMA_TIMEOUT);
+
+    self->last_stamp = Timestamp_get32();
+    self->running = true;
+    MAP_TimerEnable(self->base_addr, TIMER_A);
+}
+
+STATIC mp_obj_t machine_timer_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
+    mp_int_t id = mp_obj_get_int(args[0]);
+
+    if (id < 0 || id >= NUM_TIMER) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+
+    machine_timer_obj_t *self = &timer_obj[id];
+
+    if (n_args > 1 || n_kw > 0) {
+        mp_map_t kw_args;
+        mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
+        timer_init_helper(self, n_args - 1, args + 1, &kw_args);
+    }
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void machine_timer_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    machine_timer_obj_t *self = self_in;
+    mp_printf(print, "<machine_timer.%p> id=%u, mode=%s, period_us=%u, running=%u", self, self->id,
+        self->mode == MODE_ONE_SHOT ? "ONE_SHOT" : "PERIODIC",
+        cpu_freq ? (uint32_t)((uint64_t)self->load * 1000000 / cpu_freq) : 0, self->running);
+}
+
+STATIC mp_obj_t machine_timer_init(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    machine_timer_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    timer_init_helper(self, n_args - 1, pos_args + 1, kw_args);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_timer_init_obj, 1, machine_timer_init);
+
+STATIC mp_obj_t machine_timer_deinit(mp_obj_t self_in) {
+    machine_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    timer_stop(self);
+    MP_STATE_PORT(machine_timer_callback)[self->id] = mp_const_none;
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_timer_deinit_obj, machine_timer_deinit);
+
+/* stats() -> (count, missed, min_us, max_us, jitter_us)
+ * min/max are the shortest and longest intervals seen between interrupts
+ * and jitter is the furthest either strayed from the set period */
+STATIC mp_obj_t machine_timer_stats(mp_obj_t self_in) {
+    machine_timer_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    uint32_t key = HwiP_disable();
+    uint32_t count = self->count;
+    uint32_t missed = self->missed;
+    uint32_t min_us = count > 1 ? stamp_to_us(self->min_interval) : 0;
+    uint32_t max_us = count > 1 ? stamp_to_us(self->max_interval) : 0;
+    HwiP_restore(key);
+
+    uint32_t jitter_us = 0;
+    if (count > 1) {
+        uint32_t period_us = (uint64_t)self->load * 1000000 / cpu_freq;
+        uint32_t late = max_us > period_us ? max_us - period_us : 0;
+        uint32_t early = min_us < period_us ? period_us - min_us : 0;
+        jitter_us = MAX(late, early);
+    }
+
+    mp_obj_t stats[5] = {
+        mp_obj_new_int_from_uint(count),
+        mp_obj_new_int_from_uint(missed),
+        mp_obj_new_int_from_uint(min_us),
+        mp_obj_new_int_from_uint(max_us),
+        mp_obj_new_int_from_uint(jitter_us),
+    };
+    return mp_obj_new_tuple(5, stats);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_timer_stats_obj, machine_timer_stats);
+
+STATIC const mp_rom_map_elem_t machine_timer_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_timer_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_timer_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&machine_timer_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ONE_SHOT), MP_ROM_INT(MODE_ONE_SHOT) },
+    { MP_ROM_QSTR(MP_QSTR_PERIODIC), MP_ROM_INT(MODE_PERIODIC) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(machine_timer_locals_dict, machine_timer_locals_dict_table);
+
+const mp_obj_type_t machine_timer_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Timer,
+    .make_new = machine_timer_make_new,
+    .print = machine_timer_print,
+    .locals_dict = (mp_obj_dict_t*)&machine_timer_locals_dict,
+};
@@ -0,0 +1,7 @@
+#ifndef MACHINE_TIMER_H_INC
+#define MACHINE_TIMER_H_INC
+
+extern const mp_obj_type_t machine_timer_type;
+extern void machine_timer_teardown(void);
+
+#endif
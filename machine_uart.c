@@ -10,11 +10,22 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
 
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include "ti/devices/msp432e4/driverlib/driverlib.h"
 #include <ti/drivers/UART.h>
+#include <ti/drivers/uart/UARTMSP432E4.h>
+#include <ti/drivers/gpio/GPIOMSP432E4.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerMSP432E4.h>
+#include <ti/drivers/dpl/HwiP.h>
 
 #define MACHINE_UART_EVEN 2u
 #define MACHINE_UART_ODD 1u
@@ -26,6 +37,20 @@
 #define MACHINE_UART_TEXT 0u
 #define MACHINE_UART_BINARY 1u
 
+#define MACHINE_UART_RX_ANY 1u
+#define MACHINE_UART_RX_IDLE 2u
+
+// Receive path: the driver's interrupt handler empties the FIFO into its
+// own ring (ringBufPtr in the board file), and a callback-mode UART_read
+// that is always kept pending moves that data on into rx_buf here, in
+// whatever sized chunks have arrived.  read/readinto/readline then work on
+// rx_buf alone, waiting on rx_sem for more.  rx_head only moves in the
+// callback and rx_tail only in the VM, so neither side needs a lock.
+//
+// When rx_buf fills the pending read is not renewed, leaving the driver's
+// ring to absorb the overflow; with RTS enabled the FIFO then backs up and
+// the hardware holds the sender off.
+
 typedef struct _machine_uart_obj_t {
     mp_obj_base_t base;
     uint32_t id;
@@ -39,19 +64,215 @@ typedef struct _machine_uart_obj_t {
     uint32_t read_buf_len;
     uint32_t mode;
     bool echo;
+
+    uint8_t *rx_buf;
+    uint32_t rx_mask;               // size - 1, the size is a power of two
+    volatile uint32_t rx_head;
+    volatile uint32_t rx_tail;
+    volatile bool rx_armed;
+    bool closing;
+    Semaphore_Handle rx_sem;
+
+    Clock_Handle idle_clock;
+    uint16_t irq_trigger;
+    volatile uint16_t irq_flags;
+    mp_obj_t irq_handler;
 } machine_uart_obj_t;
 
 // TODO: figure out how to set this
 #define NUM_UARTS 3
-static UART_Handle uarts[NUM_UARTS];
+
+#define RX_BUF_DEFAULT (512)
+
+STATIC void uart_close(machine_uart_obj_t *self) {
+    if (self->uart) {
+        // cancelling calls the read callback with what it had so far
+        self->closing = true;
+        UART_readCancel(self->uart);
+        UART_close(self->uart);
+        self->uart = NULL;
+    }
+    if (self->idle_clock) {
+        Clock_stop(self->idle_clock);
+        Clock_delete(&self->idle_clock);
+    }
+    if (self->rx_sem) {
+        Semaphore_delete(&self->rx_sem);
+    }
+    self->irq_trigger = 0;
+    self->irq_handler = mp_const_none;
+    if (MP_STATE_PORT(machine_uart_obj)[self->id] == MP_OBJ_FROM_PTR(self)) {
+        MP_STATE_PORT(machine_uart_obj)[self->id] = MP_OBJ_NULL;
+    }
+}
 
 void machine_uart_teardown(void) {
     for (uint32_t i = 0; i < NUM_UARTS; i++) {
-        if (uarts[i]) {
-            UART_close(uarts[i]);
-            uarts[i] = NULL;
+        mp_obj_t obj = MP_STATE_PORT(machine_uart_obj)[i];
+        if (obj != MP_OBJ_NULL) {
+            uart_close(MP_OBJ_TO_PTR(obj));
+        }
+        MP_STATE_PORT(machine_uart_obj)[i] = MP_OBJ_NULL;
+    }
+}
+
+STATIC machine_uart_obj_t *uart_find(UART_Handle handle) {
+    for (uint32_t i = 0; i < NUM_UARTS; i++) {
+        mp_obj_t obj = MP_STATE_PORT(machine_uart_obj)[i];
+        if (obj != MP_OBJ_NULL) {
+            machine_uart_obj_t *self = MP_OBJ_TO_PTR(obj);
+            if (self->uart == handle) {
+                return self;
+            }
         }
     }
+    return NULL;
+}
+
+STATIC uint32_t uart_rx_count(machine_uart_obj_t *self) {
+    return self->rx_head - self->rx_tail;
+}
+
+// Queue a read into the free space at rx_head.  Called from the read
+// callback, or from the VM once it has made room again.
+STATIC void uart_rx_arm(machine_uart_obj_t *self) {
+    uint32_t size = self->rx_mask + 1;
+    uint32_t space = size - uart_rx_count(self);
+    if (space == 0 || self->closing) {
+        return;
+    }
+
+    uint32_t index = self->rx_head & self->rx_mask;
+    uint32_t chunk = size - index;
+    if (chunk > space) {
+        chunk = space;
+    }
+
+    // take everything the driver already holds in one go, but never ask
+    // for more than that or the callback would wait for the rest
+    int avail = 0;
+    UART_control(self->uart, UART_CMD_GETRXCOUNT, &avail);
+    if (avail < 1) {
+        avail = 1;
+    }
+    if (chunk > (uint32_t)avail) {
+        chunk = avail;
+    }
+
+    self->rx_armed = true;
+    UART_read(self->uart, self->rx_buf + index, chunk);
+}
+
+STATIC void uart_irq_post(machine_uart_obj_t *self, uint16_t flag);
+
+STATIC void uart_rx_callback(UART_Handle handle, void *buf, size_t count) {
+    machine_uart_obj_t *self = uart_find(handle);
+    if (self == NULL) {
+        return;
+    }
+
+    self->rx_armed = false;
+    self->rx_head += count;
+    if (self->closing) {
+        return;
+    }
+
+    if (count > 0) {
+        Semaphore_post(self->rx_sem);
+        if (self->irq_trigger & MACHINE_UART_RX_IDLE) {
+            // restarts the countdown if it is already running
+            Clock_start(self->idle_clock);
+        }
+        uart_irq_post(self, MACHINE_UART_RX_ANY);
+    }
+
+    uart_rx_arm(self);
+}
+
+STATIC void uart_idle_clock(UArg arg) {
+    uart_irq_post((machine_uart_obj_t *)arg, MACHINE_UART_RX_IDLE);
+}
+
+// Restart the receive side after the VM has taken data out of rx_buf.
+STATIC void uart_rx_resume(machine_uart_obj_t *self) {
+    uint32_t key = HwiP_disable();
+    if (!self->rx_armed) {
+        uart_rx_arm(self);
+    }
+    HwiP_restore(key);
+}
+
+// Block until more data arrives or the deadline, timeout ms after start,
+// passes.  Returns false once the deadline has passed.
+STATIC bool uart_rx_wait(machine_uart_obj_t *self, uint32_t start, uint32_t timeout) {
+    uint32_t ticks = (uint64_t)timeout * 1000 / Clock_tickPeriod;
+    uint32_t waited = Clock_getTicks() - start;
+    if (waited >= ticks) {
+        return false;
+    }
+    Semaphore_pend(self->rx_sem, ticks - waited);
+    return true;
+}
+
+// Wait for at least want bytes, returning how many are buffered.
+STATIC uint32_t uart_rx_wait_for(machine_uart_obj_t *self, uint32_t want) {
+    uint32_t start = Clock_getTicks();
+    while (uart_rx_count(self) < want && uart_rx_wait(self, start, self->timeout)) {
+    }
+    return uart_rx_count(self);
+}
+
+// Copy up to len buffered bytes out to buf.
+STATIC uint32_t uart_rx_take(machine_uart_obj_t *self, uint8_t *buf, uint32_t len) {
+    uint32_t count = uart_rx_count(self);
+    if (len > count) {
+        len = count;
+    }
+    uint32_t index = self->rx_tail & self->rx_mask;
+    uint32_t first = self->rx_mask + 1 - index;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(buf, self->rx_buf + index, first);
+    memcpy(buf + first, self->rx_buf, len - first);
+    self->rx_tail += len;
+
+    uart_rx_resume(self);
+    return len;
+}
+
+// Sets up RTS/CTS on the pins the board file lists for this UART.  The
+// driver only does this itself when flowControl is set in the hwAttrs,
+// which would force it on for everyone.
+STATIC bool uart_flow_init(machine_uart_obj_t *self) {
+    const UARTMSP432E4_HWAttrs *hwAttrs = ((UART_Config *)self->uart)->hwAttrs;
+    uint32_t pins[2] = { UARTMSP432E4_PIN_UNASSIGNED, UARTMSP432E4_PIN_UNASSIGNED };
+    uint32_t mode = 0;
+
+    if (self->flow & MACHINE_UART_RTS) {
+        pins[0] = hwAttrs->rtsPin;
+        mode |= UART_FLOWCONTROL_RX;
+    }
+    if (self->flow & MACHINE_UART_CTS) {
+        pins[1] = hwAttrs->ctsPin;
+        mode |= UART_FLOWCONTROL_TX;
+    }
+    if (((self->flow & MACHINE_UART_RTS) && pins[0] == UARTMSP432E4_PIN_UNASSIGNED) ||
+        ((self->flow & MACHINE_UART_CTS) && pins[1] == UARTMSP432E4_PIN_UNASSIGNED)) {
+        return false;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (pins[i] != UARTMSP432E4_PIN_UNASSIGNED) {
+            uint8_t port = GPIOMSP432E4_getPortFromPinConfig(pins[i]);
+            Power_setDependency(GPIOMSP432E4_getPowerResourceId(port));
+            MAP_GPIOPinConfigure(GPIOMSP432E4_getPinMapFromPinConfig(pins[i]));
+            MAP_GPIOPinTypeUART(GPIOMSP432E4_getGpioBaseAddr(port),
+                GPIOMSP432E4_getPinFromPinConfig(pins[i]));
+        }
+    }
+    MAP_UARTFlowControlSet(hwAttrs->baseAddr, mode);
+    return true;
 }
 
 static void uart_init_helper(machine_uart_obj_t * self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -65,19 +286,22 @@ static void uart_init_helper(machine_uart_obj_t * self, size_t n_args, const mp_
         { MP_QSTR_echo, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = 1} },
         { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1000} },
         { MP_QSTR_read_buf_len, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 64} },
+        { MP_QSTR_rxbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = RX_BUF_DEFAULT} },
     };
     enum { ARG_baudrate, ARG_bits, ARG_parity, ARG_stop, ARG_flow, ARG_mode,
-           ARG_echo, ARG_timeout, ARG_read_buf_len };
+           ARG_echo, ARG_timeout, ARG_read_buf_len, ARG_rxbuf };
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args,
         MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    // re-init starts from scratch
+    uart_close(self);
+
     UART_Params params;
     UART_Params_init(&params);
 
     self->baudrate = args[ARG_baudrate].u_int;
     params.baudRate = self->baudrate;
-
     self->bits = args[ARG_bits].u_int;
     switch (self->bits) {
     case 8:
@@ -128,8 +352,8 @@ static void uart_init_helper(machine_uart_obj_t * self, size_t n_args, const mp_
     }
 
     self->flow = args[ARG_flow].u_int;
-    if (self->flow != 0) {
-        mp_raise_OSError(MP_EOPNOTSUPP);
+    if (self->flow & ~(MACHINE_UART_RTS | MACHINE_UART_CTS)) {
+        mp_raise_OSError(MP_EINVAL);
     }
 
     self->echo = args[ARG_echo].u_bool;
@@ -152,23 +376,77 @@ static void uart_init_helper(machine_uart_obj_t * self, size_t n_args, const mp_
 
     self->read_buf_len = args[ARG_read_buf_len].u_int;
 
+    // the ring is a power of two and never smaller than read_buf_len
+    uint32_t rx_size = MAX(args[ARG_rxbuf].u_int, self->read_buf_len);
+    if (rx_size < 16) {
+        rx_size = 16;
+    }
+    uint32_t size = 16;
+    while (size < rx_size) {
+        size <<= 1;
+    }
+    if (self->rx_buf == NULL || self->rx_mask + 1 != size) {
+        self->rx_buf = m_new(uint8_t, size);
+        self->rx_mask = size - 1;
+    }
+    self->rx_head = self->rx_tail = 0;
+    self->rx_armed = false;
+    self->closing = false;
+
     self->timeout = args[ARG_timeout].u_int;
-    // TODO: validate units
-    params.readTimeout = params.writeTimeout = self->timeout;
+    params.writeTimeout = (uint64_t)self->timeout * 1000 / Clock_tickPeriod;
+    params.readMode = UART_MODE_CALLBACK;
+    params.readCallback = uart_rx_callback;
+
+    Semaphore_Params sem_params;
+    Semaphore_Params_init(&sem_params);
+    sem_params.mode = Semaphore_Mode_BINARY;
+    if ((self->rx_sem = Semaphore_create(0, &sem_params, NULL)) == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+
+    // RX_IDLE fires once the line has been quiet for about two characters,
+    // which at any useful baud rate rounds up to a single tick
+    Clock_Params clock_params;
+    Clock_Params_init(&clock_params);
+    clock_params.arg = (UArg)self;
+    uint32_t idle_us = 2 * 10 * 1000000 / self->baudrate;
+    uint32_t idle_ticks = (idle_us + Clock_tickPeriod - 1) / Clock_tickPeriod;
+    if ((self->idle_clock = Clock_create(uart_idle_clock, idle_ticks ? idle_ticks : 1,
+        &clock_params, NULL)) == NULL) {
+        uart_close(self);
+        mp_raise_OSError(MP_ENOMEM);
+    }
 
     if ((self->uart = UART_open(self->id, &params)) == NULL) {
+        uart_close(self);
         mp_raise_OSError(MP_ENODEV);
     }
-    uarts[self->id] = self->uart;
+    if (self->flow && !uart_flow_init(self)) {
+        uart_close(self);
+        mp_raise_OSError(MP_EOPNOTSUPP);
+    }
+
+    MP_STATE_PORT(machine_uart_obj)[self->id] = MP_OBJ_FROM_PTR(self);
+    uart_rx_resume(self);
 }
 
 STATIC mp_obj_t machine_uart_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, MP_OBJ_FUN_ARGS_MAX, true);
     mp_int_t id = mp_obj_get_int(args[0]);
+    if (id < 0 || id >= NUM_UARTS) {
+        mp_raise_OSError(MP_ENODEV);
+    }
     machine_uart_obj_t *self = m_new_obj(machine_uart_obj_t);
     self->base.type = type;
     self->id = id;
     self->uart = NULL;
+    self->rx_buf = NULL;
+    self->rx_sem = NULL;
+    self->idle_clock = NULL;
+    self->irq_trigger = 0;
+    self->irq_flags = 0;
+    self->irq_handler = mp_const_none;
 
     if (n_args > 1 || n_kw > 0) {
         mp_map_t kw_args;
@@ -191,51 +469,73 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_uart_init_obj, 1, machine_uart_init);
 STATIC void machine_uart_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     machine_uart_obj_t *self = self_in;
     mp_printf(print, "<machine_uart.%p> id=%d baudrate=%d bits=%d parity=%d "
-              "stop=%d flow=0x%x mode=%d timeout=%d read_buf_len=%d",
+              "stop=%d flow=0x%x mode=%d timeout=%d read_buf_len=%d rxbuf=%d",
               self, self->id, self->baudrate, self->bits, self->parity,
               self->stop, self->flow, self->mode, self->timeout,
-              self->read_buf_len);
+              self->read_buf_len, self->rx_buf ? self->rx_mask + 1 : 0);
 }
 
 STATIC mp_obj_t machine_uart_deinit(mp_obj_t self_in) {
     machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
-    UART_close(self->uart);
-    self->uart = NULL;
+    uart_close(self);
 
     return mp_const_none;
 }
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_deinit_obj, machine_uart_deinit);
 
-STATIC mp_obj_t machine_uart_any(mp_obj_t self_in) {
+STATIC machine_uart_obj_t *uart_get_open(mp_obj_t self_in) {
     machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t result = mp_const_none;
-    uint32_t count = 0;
-
-    if (UART_control(self->uart, UART_CMD_GETRXCOUNT, (void *)&count) >= 0) {
-        result = MP_OBJ_NEW_SMALL_INT(count);
+    if (self->uart == NULL) {
+        mp_raise_OSError(MP_EBADF);
     }
-    else {
+    return self;
+}
+
+STATIC mp_obj_t machine_uart_any(mp_obj_t self_in) {
+    machine_uart_obj_t *self = uart_get_open(self_in);
+    int count = 0;
+
+    // bytes still in the driver's ring count too, they just have not been
+    // moved across yet
+    if (UART_control(self->uart, UART_CMD_GETRXCOUNT, (void *)&count) < 0) {
         mp_raise_OSError(MP_EIO);
     }
 
-    return result;
+    return MP_OBJ_NEW_SMALL_INT(uart_rx_count(self) + count);
 }
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_any_obj, machine_uart_any);
 
+// Fill buf from the ring, waiting up to timeout for the rest.  Returns the
+// number of bytes copied.
+STATIC uint32_t uart_read_into(machine_uart_obj_t *self, uint8_t *buf, uint32_t len) {
+    uint32_t start = Clock_getTicks();
+    uint32_t got = 0;
+    for (;;) {
+        got += uart_rx_take(self, buf + got, len - got);
+        if (got == len || !uart_rx_wait(self, start, self->timeout)) {
+            return got;
+        }
+    }
+}
+
 STATIC mp_obj_t machine_uart_read(size_t n_args, const mp_obj_t *args) {
-    machine_uart_obj_t *self = MP_OBJ_TO_PTR(args[0]);
-    uint32_t nbytes = self->read_buf_len;
+    machine_uart_obj_t *self = uart_get_open(args[0]);
+    uint32_t nbytes;
     if (n_args > 1) {
         nbytes = mp_obj_get_int(args[1]);
     }
+    else {
+        // whatever has arrived, once there is something
+        nbytes = uart_rx_wait_for(self, 1);
+    }
 
     vstr_t vstr;
     vstr_init_len(&vstr, nbytes);
 
-    int32_t num_read = UART_read(self->uart, vstr.buf, nbytes);
+    uint32_t num_read = uart_read_into(self, (uint8_t *)vstr.buf, nbytes);
     if (num_read > 0) {
         vstr.len = num_read;
         return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
@@ -249,14 +549,14 @@ STATIC mp_obj_t machine_uart_read(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(machine_uart_read_obj, 1, machine_uart_read);
 
 STATIC mp_obj_t machine_uart_readinto(size_t n_args, const mp_obj_t *args) {
-    machine_uart_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    machine_uart_obj_t *self = uart_get_open(args[0]);
     mp_buffer_info_t buf_info;
     mp_get_buffer_raise(args[1], &buf_info, MP_BUFFER_WRITE);
     uint32_t nbytes = buf_info.len;
     if (n_args > 2) {
-        nbytes = mp_obj_get_int(args[2]);
+        nbytes = MIN(buf_info.len, (uint32_t)mp_obj_get_int(args[2]));
     }
-    int32_t num_read = UART_read(self->uart, buf_info.buf, nbytes);
+    uint32_t num_read = uart_read_into(self, buf_info.buf, nbytes);
     mp_obj_t result = mp_const_none;
     if (num_read > 0) {
         result = MP_OBJ_NEW_SMALL_INT(num_read);
@@ -268,30 +568,104 @@ STATIC mp_obj_t machine_uart_readinto(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(machine_uart_readinto_obj, 2, machine_uart_readinto);
 
 STATIC mp_obj_t machine_uart_readline(mp_obj_t self_in) {
-    machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    machine_uart_obj_t *self = uart_get_open(self_in);
+
+    // scan the ring as data arrives, remembering how far we have looked so
+    // each byte is only checked once
+    uint32_t start = Clock_getTicks();
+    uint32_t scanned = 0;
+    uint32_t len = 0;
+    while (len == 0) {
+        uint32_t count = uart_rx_count(self);
+        for (; scanned < count; scanned++) {
+            if (self->rx_buf[(self->rx_tail + scanned) & self->rx_mask] == '\n') {
+                len = scanned + 1;
+                break;
+            }
+        }
+        if (len == 0 && (count > self->rx_mask || !uart_rx_wait(self, start, self->timeout))) {
+            // full with no newline, or out of time: return what there is
+            len = uart_rx_count(self);
+            break;
+        }
+    }
 
-    if (self->mode == MACHINE_UART_BINARY) {
-        mp_raise_OSError(MP_EINVAL);
+    if (len == 0) {
+        return mp_const_none;
     }
 
     vstr_t vstr;
-    vstr_init_len(&vstr, self->read_buf_len);
+    vstr_init_len(&vstr, len);
+    uart_rx_take(self, (uint8_t *)vstr.buf, len);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
 
-    int32_t num_read = UART_read(self->uart, vstr.buf, self->read_buf_len);
-    if (num_read > 0) {
-        vstr.len = num_read;
-        return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_readline_obj, machine_uart_readline);
+
+STATIC mp_obj_t uart_irq_dispatch(mp_obj_t self_in) {
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->irq_flags = 0;
+    if (self->irq_handler != mp_const_none) {
+        mp_call_function_1(self->irq_handler, self_in);
     }
-    else {
-        vstr_clear(&vstr);
-        return mp_const_none;
+    return mp_const_none;
+}
+
+// Called from the read callback or the idle clock; runs the handler later
+// in the VM via uart_irq_dispatch.  A trigger that is already waiting to
+// be handled is not queued twice.
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uart_irq_dispatch_obj, uart_irq_dispatch);
+
+STATIC void uart_irq_post(machine_uart_obj_t *self, uint16_t flag) {
+    if ((self->irq_trigger & flag) == 0) {
+        return;
+    }
+    uint16_t pending = self->irq_flags;
+    self->irq_flags = pending | flag;
+    if (pending == 0) {
+        if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&uart_irq_dispatch_obj), MP_OBJ_FROM_PTR(self))) {
+            self->irq_flags = 0;
+        }
     }
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_readline_obj, machine_uart_readline);
+/* irq(handler=None, trigger=RX_ANY) -> call handler(uart) as data arrives */
+STATIC mp_obj_t machine_uart_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_trigger, MP_ARG_INT, {.u_int = MACHINE_UART_RX_ANY} },
+    };
+    enum { ARG_handler, ARG_trigger };
+    machine_uart_obj_t *self = uart_get_open(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t handler = args[ARG_handler].u_obj;
+    uint32_t trigger = args[ARG_trigger].u_int;
+    if (handler != mp_const_none && !mp_obj_is_callable(handler)) {
+        mp_raise_ValueError("handler must be callable");
+    }
+    if (trigger & ~(MACHINE_UART_RX_ANY | MACHINE_UART_RX_IDLE)) {
+        mp_raise_ValueError("invalid trigger");
+    }
+
+    uint32_t key = HwiP_disable();
+    self->irq_handler = handler;
+    self->irq_trigger = handler == mp_const_none ? 0 : trigger;
+    self->irq_flags = 0;
+    HwiP_restore(key);
+    if (!(self->irq_trigger & MACHINE_UART_RX_IDLE)) {
+        Clock_stop(self->idle_clock);
+    }
+
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_uart_irq_obj, 1, machine_uart_irq);
 
 STATIC mp_obj_t machine_uart_write(mp_obj_t self_in, mp_obj_t buf_in) {
-    machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    machine_uart_obj_t *self = uart_get_open(self_in);
     mp_buffer_info_t buf_info;
     mp_get_buffer_raise(buf_in, &buf_info, MP_BUFFER_READ);
 
@@ -322,6 +696,8 @@ STATIC const mp_rom_map_elem_t machine_uart_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_ODD), MP_ROM_INT(MACHINE_UART_ODD) },
     { MP_ROM_QSTR(MP_QSTR_TEXT), MP_ROM_INT(MACHINE_UART_TEXT) },
     { MP_ROM_QSTR(MP_QSTR_BINARY), MP_ROM_INT(MACHINE_UART_BINARY) },
+    { MP_ROM_QSTR(MP_QSTR_RX_ANY), MP_ROM_INT(MACHINE_UART_RX_ANY) },
+    { MP_ROM_QSTR(MP_QSTR_RX_IDLE), MP_ROM_INT(MACHINE_UART_RX_IDLE) },
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_uart_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_uart_deinit_obj) },
     { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&machine_uart_any_obj) },
@@ -330,6 +706,7 @@ STATIC const mp_rom_map_elem_t machine_uart_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&machine_uart_readline_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&machine_uart_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendbreak), MP_ROM_PTR(&machine_uart_sendbreak_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&machine_uart_irq_obj) },
 #ifdef MACHINE_UART_IDS
     MACHINE_UART_IDS
 #endif
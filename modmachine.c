@@ -10,12 +10,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
+#include "py/gc.h"
 
 #include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
 #include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/hal/Hwi.h>
 #include <xdc/runtime/Memory.h>
 
 #include <SoC.h>
@@ -24,20 +28,31 @@
 
 #include "machine_adc.h"
 #include "machine_eeprom.h"
+#include "machine_settings.h"
 #include "machine_i2c.h"
 #include "machine_pin.h"
 #include "machine_pwm.h"
 #include "machine_rtc.h"
 #include "machine_spi.h"
+#include "machine_timer.h"
 #include "machine_uart.h"
 
+#include "modmachine.h"
 #include "machine_nvsbdev.h"
 #include "machine_sd.h"
 
+#include "boot_profile.h"
+#include "fastram.h"
+#include "console_tx.h"
+
 #if MICROPY_HW_HAS_NEOPIX
 #include "neopix.h"
 #endif
 
+#if MICROPY_HW_HAS_UGFX
+#include "ugfx_heap.h"
+#endif
+
 #define MACHINE_IDLE (1)
 #define MACHINE_SLEEP (2)
 #define MACHINE_DEEPSLEEP (3)
@@ -46,9 +61,6 @@
 #define MACHINE_WDT_RESET (12)
 #define MACHINE_DEEPSLEEP_RESET (13)
 #define MACHINE_SOFT_RESET (14)
-#define MACHINE_WLAN_WAKE (20)
-#define MACHINE_PIN_WAKE (21)
-#define MACHINE_RTC_WAKE (22)
 
 #if MICROPY_PY_MACHINE
 
@@ -69,11 +81,16 @@ void machine_teardown(void) {
     machine_spi_teardown();
     machine_uart_teardown();
     machine_pwm_teardown();
+    machine_timer_teardown();
     machine_adc_teardown();
     machine_rtc_teardown();
 //TODO: Teardown flash_bdev
     MACHINE_SD_TEARDOWN();
 
+    // a script that silenced the console mustn't leave the REPL silent
+    console_tx_set_channels(CONSOLE_TX_USB | CONSOLE_TX_UART);
+    console_tx_set_overflow(CONSOLE_TX_BLOCK);
+
     if (machine_sleep_sem) {
         Semaphore_delete(&machine_sleep_sem);
     }
@@ -88,6 +105,34 @@ void machine_setup(void) {
     }
 }
 
+#define WAKE_BIT(reason) MACHINE_WAKE_BIT(reason)
+#define WAKE_ALL (~0u)
+
+static volatile uint32_t wake_mask = WAKE_ALL;
+static volatile uint32_t wake_reason;
+static volatile uint32_t wake_pending;
+static uint32_t asleep_ms;
+
+void machine_wake(uint32_t reason) {
+    if (wake_mask & WAKE_BIT(reason)) {
+        UInt key = Hwi_disable();
+        wake_pending |= WAKE_BIT(reason);
+        Hwi_restore(key);
+        wake_reason = reason;
+        if (machine_sleep_sem) {
+            Semaphore_post(machine_sleep_sem);
+        }
+    }
+}
+
+uint32_t machine_wake_take(void) {
+    UInt key = Hwi_disable();
+    uint32_t pending = wake_pending;
+    wake_pending = 0;
+    Hwi_restore(key);
+    return pending;
+}
+
 STATIC mp_obj_t machine_sleep() {
     Semaphore_pend(machine_sleep_sem, BIOS_WAIT_FOREVER);
     return mp_const_none;
@@ -95,6 +140,99 @@ STATIC mp_obj_t machine_sleep() {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_sleep_obj, machine_sleep);
 
+/* lightsleep([ms], *, wake=None) -> ms spent asleep
+ * Stops the periodic work (sensor polling, the uGFX toggle poll) so the
+ * idle task can keep the CPU asleep between clock events, until one of
+ * the wake sources (PIN_WAKE, USB_WAKE, WLAN_WAKE, TIMER_WAKE) fires or
+ * ms runs out (RTC_WAKE).  wake=None allows all of them */
+STATIC mp_obj_t machine_lightsleep(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_ms, ARG_wake };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_ms, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_wake, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args,
+        MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    uint32_t timeout = BIOS_WAIT_FOREVER;
+    if (args[ARG_ms].u_obj != mp_const_none) {
+        mp_int_t ms = mp_obj_get_int(args[ARG_ms].u_obj);
+        timeout = ms > 0 ? (uint64_t)ms * 1000 / Clock_tickPeriod : 0;
+    }
+
+    uint32_t mask = WAKE_ALL;
+    if (args[ARG_wake].u_obj != mp_const_none) {
+        size_t len;
+        mp_obj_t *items;
+        if (MP_OBJ_IS_INT(args[ARG_wake].u_obj)) {
+            len = 1;
+            items = &args[ARG_wake].u_obj;
+        } else {
+            mp_obj_get_array(args[ARG_wake].u_obj, &len, &items);
+        }
+        mask = 0;
+        for (size_t i = 0; i < len; i++) {
+            mp_int_t reason = mp_obj_get_int(items[i]);
+            if (reason < MACHINE_WLAN_WAKE || reason > MACHINE_TIMER_WAKE) {
+                mp_raise_ValueError("invalid wake source");
+            }
+            mask |= WAKE_BIT(reason);
+        }
+    }
+
+    #if MICROPY_PY_TILDA
+    extern void tildaQuiesce(bool quiesce);
+    tildaQuiesce(true);
+    #endif
+    #if MICROPY_HW_HAS_UGFX
+    extern void ginputToggleSuspend(int8_t suspend);
+    ginputToggleSuspend(true);
+    #endif
+
+    // narrow the sources first, then drop any wakeup left over from
+    // before, so nothing outside the mask can get in between; the drain
+    // and the reset of the reason go together so a wakeup right after
+    // can't be reported as RTC_WAKE
+    wake_mask = mask;
+    UInt key = Hwi_disable();
+    Semaphore_pend(machine_sleep_sem, BIOS_NO_WAIT);
+    wake_reason = MACHINE_RTC_WAKE;
+    Hwi_restore(key);
+
+    uint32_t start = Clock_getTicks();
+    Semaphore_pend(machine_sleep_sem, timeout);
+    uint32_t slept = (uint64_t)(Clock_getTicks() - start) * Clock_tickPeriod / 1000;
+
+    wake_mask = WAKE_ALL;
+
+    #if MICROPY_HW_HAS_UGFX
+    ginputToggleSuspend(false);
+    #endif
+    #if MICROPY_PY_TILDA
+    tildaQuiesce(false);
+    #endif
+
+    asleep_ms += slept;
+    return mp_obj_new_int_from_uint(slept);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_lightsleep_obj, 0, machine_lightsleep);
+
+/* wake_reason() -> what ended the last lightsleep */
+STATIC mp_obj_t machine_wake_reason() {
+    return MP_OBJ_NEW_SMALL_INT(wake_reason);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_wake_reason_obj, machine_wake_reason);
+
+/* asleep_ms() -> total time spent in lightsleep since power on */
+STATIC mp_obj_t machine_asleep_ms() {
+    return mp_obj_new_int_from_uint(asleep_ms);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_asleep_ms_obj, machine_asleep_ms);
+
 STATIC mp_obj_t machine_reset_cause() {
     uint32_t cause = SoC_getResetCause();
 
@@ -178,7 +316,53 @@ STATIC mp_obj_t machine_disable_irq() {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_disable_irq_obj, machine_disable_irq);
 
-STATIC mp_obj_t machine_heap_info() {
+STATIC mp_obj_t heap_info_entry(size_t total, size_t free, size_t largest_free) {
+    // fragmentation: how much of the free space is outside the largest block
+    size_t frag = free ? 100 - largest_free * 100 / free : 0;
+    mp_obj_t entry[4] = {
+        mp_obj_new_int_from_uint(total),
+        mp_obj_new_int_from_uint(free),
+        mp_obj_new_int_from_uint(largest_free),
+        mp_obj_new_int_from_uint(frag),
+    };
+    return mp_obj_new_tuple(4, entry);
+}
+
+STATIC mp_obj_t heap_info_all(void) {
+    mp_obj_t info = mp_obj_new_dict(4);
+
+    gc_info_t gc;
+    gc_info(&gc);
+    mp_obj_dict_store(info, MP_OBJ_NEW_QSTR(MP_QSTR_gc),
+        heap_info_entry(gc.total, gc.free, gc.max_free * MICROPY_BYTES_PER_GC_BLOCK));
+
+    Memory_Stats mem;
+    Memory_getStats(0, &mem);
+    mp_obj_dict_store(info, MP_OBJ_NEW_QSTR(MP_QSTR_rtos),
+        heap_info_entry(mem.totalSize, mem.totalFreeSize, mem.largestFreeSize));
+
+    #if MICROPY_HW_HAS_UGFX
+    ugfx_heap_stats_t ugfx;
+    ugfx_heap_stats(&ugfx);
+    mp_obj_dict_store(info, MP_OBJ_NEW_QSTR(MP_QSTR_ugfx),
+        heap_info_entry(ugfx.total, ugfx.free, ugfx.largest_free));
+    #endif
+
+    size_t fast_free = MICROPY_HW_FASTRAM_SIZE - fastram_used();
+    mp_obj_dict_store(info, MP_OBJ_NEW_QSTR(MP_QSTR_fastram),
+        heap_info_entry(MICROPY_HW_FASTRAM_SIZE, fast_free, fast_free));
+
+    return info;
+}
+
+/* heap_info() -> (total, free, largest_free) of the TI-RTOS heap, as it
+ * always has.  heap_info(name) -> (total, free, largest_free, frag_percent)
+ * for one of the heaps listed by heaps() */
+STATIC mp_obj_t machine_heap_info(size_t n_args, const mp_obj_t *args) {
+    if (n_args > 0) {
+        return mp_obj_dict_get(heap_info_all(), args[0]);
+    }
+
     Memory_Stats mem;
     Memory_getStats(0, &mem);
     mp_obj_t heap[3] = {
@@ -186,13 +370,113 @@ STATIC mp_obj_t machine_heap_info() {
         mp_obj_new_int(mem.totalFreeSize),
         mp_obj_new_int(mem.largestFreeSize),
     };
+    return mp_obj_new_tuple(3, heap);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_heap_info_obj, 0, 1, machine_heap_info);
+
+/* heaps() -> {name: (total, free, largest_free, frag_percent), ...} for the
+ * GC heap, the TI-RTOS heap, the uGFX pool and the fastram arena */
+STATIC mp_obj_t machine_heaps(void) {
+    return heap_info_all();
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_heaps_obj, machine_heaps);
+
+/* fastram(size) -> bytearray in internal SRAM rather than the SDRAM heap.
+ * The arena (MICROPY_HW_FASTRAM_SIZE, 16K) is only emptied by a soft
+ * reset: dropping the bytearray doesn't give its space back, so allocate
+ * once at start-up rather than in a loop.  The pystack next to it
+ * (MICROPY_HW_PYSTACK_SIZE, 8K) holds every Python call frame, so it is
+ * what limits recursion depth; running out raises RuntimeError */
+STATIC mp_obj_t machine_fastram(mp_obj_t size_in) {
+    mp_int_t size = mp_obj_get_int(size_in);
+    if (size < 0) {
+        mp_raise_ValueError("negative size");
+    }
+    void *buf = fastram_alloc(size);
+    if (buf == NULL) {
+        mp_raise_msg(&mp_type_MemoryError, "fastram full");
+    }
+    memset(buf, 0, size);
+    return mp_obj_new_bytearray_by_ref(size, buf);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_fastram_obj, machine_fastram);
+
+/* boot_profile([phase]) -> [(phase, at_us, took_us), ...]
+ * With an argument, marks the end of a phase (eg from boot.py) instead */
+STATIC mp_obj_t machine_boot_profile(size_t n_args, const mp_obj_t *args) {
+    if (n_args > 0) {
+        boot_profile_mark(mp_obj_str_get_str(args[0]));
+        return mp_const_none;
+    }
+
+    uint32_t count = boot_profile_count();
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint32_t prev = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const char *name = boot_profile_name(i);
+        uint32_t us = boot_profile_us(i);
+        mp_obj_t entry[3] = {
+            mp_obj_new_str(name, strlen(name)),
+            mp_obj_new_int_from_uint(us),
+            mp_obj_new_int_from_uint(us - prev),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(3, entry));
+        prev = us;
+    }
+
+    return list;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_boot_profile_obj, 0, 1, machine_boot_profile);
+
+// machine.console(*, usb, uart, overflow, flush=False) sets which channels
+// the REPL output goes to and what happens when it comes faster than they
+// take it; returns the number of bytes dropped so far.
+STATIC mp_obj_t machine_console(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_usb, ARG_uart, ARG_overflow, ARG_flush };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_usb, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_uart, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_overflow, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_flush, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t overflow = args[ARG_overflow].u_int;
+    if (overflow != -1) {
+        if (overflow != CONSOLE_TX_BLOCK && overflow != CONSOLE_TX_DROP) {
+            mp_raise_ValueError("invalid overflow");
+        }
+        console_tx_set_overflow(overflow);
+    }
+
+    uint32_t channels = console_tx_channels();
+    if (args[ARG_usb].u_obj != MP_OBJ_NULL) {
+        channels = mp_obj_is_true(args[ARG_usb].u_obj) ?
+            (channels | CONSOLE_TX_USB) : (channels & ~CONSOLE_TX_USB);
+    }
+    if (args[ARG_uart].u_obj != MP_OBJ_NULL) {
+        channels = mp_obj_is_true(args[ARG_uart].u_obj) ?
+            (channels | CONSOLE_TX_UART) : (channels & ~CONSOLE_TX_UART);
+    }
+    console_tx_set_channels(channels);
+
+    if (args[ARG_flush].u_bool) {
+        console_tx_flush();
+    }
 
-    return MP_OBJ_TO_PTR(mp_obj_new_tuple(3, heap));
+    return mp_obj_new_int_from_uint(console_tx_dropped());
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_heap_info_obj, machine_heap_info);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_console_obj, 0, machine_console);
 
 STATIC mp_obj_t machine_reset() {
+    console_tx_flush();
     SoC_reset();
 
     /* if reset() is not implemented, falls thru to here */
@@ -230,12 +514,19 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(machine_idle_obj, machine_idle);
 STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_machine) },
     { MP_ROM_QSTR(MP_QSTR_sleep), MP_ROM_PTR(&machine_sleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_lightsleep), MP_ROM_PTR(&machine_lightsleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wake_reason), MP_ROM_PTR(&machine_wake_reason_obj) },
+    { MP_ROM_QSTR(MP_QSTR_asleep_ms), MP_ROM_PTR(&machine_asleep_ms_obj) },
     { MP_ROM_QSTR(MP_QSTR_reset_cause), MP_ROM_PTR(&machine_reset_cause_obj) },
     { MP_ROM_QSTR(MP_QSTR_enable_irq), MP_ROM_PTR(&machine_enable_irq_obj) },
     { MP_ROM_QSTR(MP_QSTR_freq), MP_ROM_PTR(&machine_freq_obj) },
     { MP_ROM_QSTR(MP_QSTR_time_pulse_us), MP_ROM_PTR(&machine_time_pulse_us_obj) },
     { MP_ROM_QSTR(MP_QSTR_disable_irq), MP_ROM_PTR(&machine_disable_irq_obj) },
     { MP_ROM_QSTR(MP_QSTR_heap_info), MP_ROM_PTR(&machine_heap_info_obj) },
+    { MP_ROM_QSTR(MP_QSTR_heaps), MP_ROM_PTR(&machine_heaps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_boot_profile), MP_ROM_PTR(&machine_boot_profile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fastram), MP_ROM_PTR(&machine_fastram_obj) },
+    { MP_ROM_QSTR(MP_QSTR_console), MP_ROM_PTR(&machine_console_obj) },
     { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&machine_reset_obj) },
     { MP_ROM_QSTR(MP_QSTR_unique_id), MP_ROM_PTR(&machine_unique_id_obj) },
     { MP_ROM_QSTR(MP_QSTR_deepsleep), MP_ROM_PTR(&machine_deepsleep_obj) },
@@ -249,8 +540,12 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_DEEPSLEEP), MP_ROM_INT(MACHINE_DEEPSLEEP) },
     { MP_ROM_QSTR(MP_QSTR_DEEPSLEEP_RESET), MP_ROM_INT(MACHINE_DEEPSLEEP_RESET) },
     { MP_ROM_QSTR(MP_QSTR_WLAN_WAKE), MP_ROM_INT(MACHINE_WLAN_WAKE) },
+    { MP_ROM_QSTR(MP_QSTR_USB_WAKE), MP_ROM_INT(MACHINE_USB_WAKE) },
+    { MP_ROM_QSTR(MP_QSTR_TIMER_WAKE), MP_ROM_INT(MACHINE_TIMER_WAKE) },
     { MP_ROM_QSTR(MP_QSTR_SOFT_RESET), MP_ROM_INT(MACHINE_SOFT_RESET) },
     { MP_ROM_QSTR(MP_QSTR_SLEEP), MP_ROM_INT(MACHINE_SLEEP) },
+    { MP_ROM_QSTR(MP_QSTR_CONSOLE_BLOCK), MP_ROM_INT(CONSOLE_TX_BLOCK) },
+    { MP_ROM_QSTR(MP_QSTR_CONSOLE_DROP), MP_ROM_INT(CONSOLE_TX_DROP) },
 
     { MP_ROM_QSTR(MP_QSTR_mem8), MP_ROM_PTR(&machine_mem8_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem16), MP_ROM_PTR(&machine_mem16_obj) },
@@ -261,6 +556,7 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_SPI), MP_ROM_PTR(&machine_spi_type) },
     { MP_ROM_QSTR(MP_QSTR_UART), MP_ROM_PTR(&machine_uart_type) },
     { MP_ROM_QSTR(MP_QSTR_PWM), MP_ROM_PTR(&machine_pwm_type) },
+    { MP_ROM_QSTR(MP_QSTR_Timer), MP_ROM_PTR(&machine_timer_type) },
     { MP_ROM_QSTR(MP_QSTR_ADC), MP_ROM_PTR(&machine_adc_type) },
     { MP_ROM_QSTR(MP_QSTR_RTC), MP_ROM_PTR(&machine_rtc_type) },
 
@@ -268,6 +564,7 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_Neopix), (mp_obj_t)&pyb_neopix_type },
 #endif
     MACHINE_EEPROM_CLASS
+    MACHINE_SETTINGS_CLASS
     MACHINE_SD_CLASS
 };
 
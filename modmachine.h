@@ -1,6 +1,26 @@
 #ifndef __MICROPY_INCLUDED_TI_MODMACHINE_H__
 #define __MICROPY_INCLUDED_TI_MODMACHINE_H__
 
+#include <stdint.h>
+
+// wake reasons, as returned by machine.wake_reason()
+#define MACHINE_WLAN_WAKE (20)
+#define MACHINE_PIN_WAKE (21)
+#define MACHINE_RTC_WAKE (22)
+#define MACHINE_USB_WAKE (23)
+#define MACHINE_TIMER_WAKE (24)
+
+#define MACHINE_WAKE_BIT(reason) (1u << ((reason) - MACHINE_WLAN_WAKE))
+
 extern void machine_teardown(void);
 
+// Wakes machine.sleep(), time.sleep() (which sleeps on after a
+// MACHINE_TIMER_WAKE) and, if the reason is one of the sources it was
+// given, machine.lightsleep().  Safe from interrupts.
+extern void machine_wake(uint32_t reason);
+
+// Returns the reasons machine_wake() has been called with since the last
+// call, as MACHINE_WAKE_BIT()s, and clears them.
+extern uint32_t machine_wake_take(void);
+
 #endif
@@ -31,6 +31,7 @@
 #include "py/runtime.h"
 #include "py/objarray.h"
 #include "py/objstr.h"
+#include "py/mperrno.h"
 
 #if MICROPY_HW_HAS_UGFX
 
@@ -40,6 +41,14 @@
 #include "tilda_thread.h"
 
 #include "modugfx/board_ILI9341.h"
+#include "modugfx/ugfx_heap.h"
+
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/hal/Hwi.h>
+#include <xdc/runtime/Timestamp.h>
+#include <xdc/runtime/Types.h>
 
 //#include "genhdr/pins.h"
 //#include "bufhelper.h"
@@ -478,13 +487,196 @@ STATIC mp_obj_t ugfx_set_tear_line(mp_obj_t line_in) {
 	int l = mp_obj_get_int(line_in);
 
 	write_index(0, 0x44);
-	write_data(0, (l&0x100) >> 16);
+	write_data(0, (l&0x100) >> 8);
 	write_data(0, l&0xFF);
 
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_set_tear_line_obj, ugfx_set_tear_line);
 
+// Frame pacing off the panel's TE output.  The ILI9341 raises TE at the start
+// of vertical blanking; writing straight after that edge means our pixels land
+// behind the scan line and never overtake it mid-frame.  The interrupt is
+// only left on while something wants it: a frame_sync() callback, or
+// present() calls coming at least every UGFX_TE_IDLE_FRAMES frames.
+#define UGFX_TE_IDLE_FRAMES (8)
+
+STATIC Semaphore_Handle ugfx_te_sem;
+STATIC volatile bool ugfx_te_armed;
+STATIC volatile bool ugfx_present_waiting;
+STATIC volatile uint8_t ugfx_te_idle;
+STATIC volatile uint32_t ugfx_te_stamp;
+STATIC volatile uint32_t ugfx_te_period;
+STATIC uint32_t ugfx_present_stamp;
+
+STATIC uint32_t ugfx_stamp_to_us(uint32_t stamp) {
+    xdc_runtime_Types_FreqHz freq;
+    Timestamp_getFreq(&freq);
+    return (uint64_t)stamp * 1000000u / freq.lo;
+}
+
+STATIC void ugfx_te_callback(uint_least8_t index) {
+    uint32_t now = Timestamp_get32();
+    // the first edge after arming only sets the stamp
+    if (ugfx_te_stamp) {
+        ugfx_te_period = now - ugfx_te_stamp;
+    }
+    ugfx_te_stamp = now ? now : 1;
+    Semaphore_post(ugfx_te_sem);
+
+    if (MP_STATE_PORT(ugfx_frame_callback) != mp_const_none) {
+        mp_sched_schedule(MP_STATE_PORT(ugfx_frame_callback), mp_const_none);
+        ugfx_te_idle = 0;
+    } else if (ugfx_present_waiting) {
+        ugfx_te_idle = 0;
+    } else if (++ugfx_te_idle >= UGFX_TE_IDLE_FRAMES) {
+        // nobody has asked for a while, stop waking the CPU at 70Hz
+        GPIO_disableInt(MICROPY_HW_UGFX_PIN_TEAR);
+        ugfx_te_armed = false;
+    }
+}
+
+STATIC void ugfx_te_arm(void) {
+    if (ugfx_te_armed) {
+        return;
+    }
+    if (!ugfx_te_sem) {
+        Semaphore_Params params;
+        Semaphore_Params_init(&params);
+        params.mode = Semaphore_Mode_BINARY;
+        ugfx_te_sem = Semaphore_create(0, &params, NULL);
+    }
+    ugfx_te_stamp = 0;
+    ugfx_te_period = 0;
+    ugfx_te_idle = 0;
+
+    // TE mode 0: pulse on V-blank only
+    write_index(0, 0x35);
+    write_data(0, 0);
+
+    GPIO_setCallback(MICROPY_HW_UGFX_PIN_TEAR, ugfx_te_callback);
+    GPIO_enableInt(MICROPY_HW_UGFX_PIN_TEAR);
+    ugfx_te_armed = true;
+}
+
+STATIC void ugfx_te_disarm(void) {
+    if (ugfx_te_armed) {
+        GPIO_disableInt(MICROPY_HW_UGFX_PIN_TEAR);
+        GPIO_setCallback(MICROPY_HW_UGFX_PIN_TEAR, NULL);
+        ugfx_te_armed = false;
+    }
+}
+
+// Called from mp_main() on every (soft) reset
+void ugfx_frame_sync_init0(void) {
+    ugfx_te_disarm();
+    ugfx_present_waiting = false;
+    ugfx_present_stamp = 0;
+    MP_STATE_PORT(ugfx_frame_callback) = mp_const_none;
+}
+
+/// \method present(draw=None, *, timeout=100)
+///
+/// Waits for the next TE pulse from the panel, then calls `draw` (if given),
+/// redraws any moved sprites and flushes, so the frame is written behind the
+/// scan line.  Returns the time in microseconds since the previous present(),
+/// which is the frame period the caller is actually achieving (0 on the first
+/// call).  Raises OSError(ETIMEDOUT) if no TE pulse arrives within `timeout` ms.
+///
+STATIC mp_obj_t ugfx_present(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_draw, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_draw, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 100} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // once this is set the TE interrupt won't switch itself off
+    UInt key = Hwi_disable();
+    ugfx_present_waiting = true;
+    Hwi_restore(key);
+    ugfx_te_arm();
+
+    // drop a stale edge so we sync to the next blanking period, not the last
+    Semaphore_pend(ugfx_te_sem, BIOS_NO_WAIT);
+
+    uint32_t ticks = (args[ARG_timeout].u_int * 1000) / Clock_tickPeriod;
+    bool synced = Semaphore_pend(ugfx_te_sem, ticks);
+    ugfx_present_waiting = false;
+    if (!synced) {
+        if (MP_STATE_PORT(ugfx_frame_callback) == mp_const_none) {
+            ugfx_te_disarm();
+        }
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+
+    uint32_t stamp = ugfx_te_stamp;
+    uint32_t period = ugfx_present_stamp ? ugfx_stamp_to_us(stamp - ugfx_present_stamp) : 0;
+    ugfx_present_stamp = stamp;
+
+    if (args[ARG_draw].u_obj != mp_const_none) {
+        mp_call_function_0(args[ARG_draw].u_obj);
+    }
+    mp_call_function_0(MP_OBJ_FROM_PTR(&ugfx_sprite_draw_all_obj));
+    gdispFlush();
+
+    return mp_obj_new_int_from_uint(period);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ugfx_present_obj, 0, ugfx_present);
+
+/// \method frame_sync(callback)
+///
+/// Schedules `callback(None)` on every TE pulse (pass None to stop).  The
+/// callback runs as a soft interrupt, after the pulse, so it can draw directly.
+///
+STATIC mp_obj_t ugfx_frame_sync(mp_obj_t callback) {
+    if (callback != mp_const_none && !mp_obj_is_callable(callback)) {
+        mp_raise_TypeError("callback must be callable or None");
+    }
+    MP_STATE_PORT(ugfx_frame_callback) = callback;
+    if (callback != mp_const_none) {
+        ugfx_te_arm();
+    } else if (!ugfx_present_waiting) {
+        ugfx_te_disarm();
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_frame_sync_obj, ugfx_frame_sync);
+
+/// \method frame_period()
+///
+/// Returns the panel's refresh period in microseconds, measured between the
+/// last two TE pulses, or 0 if frame sync has not been running long enough.
+///
+STATIC mp_obj_t ugfx_frame_period(void) {
+    return mp_obj_new_int_from_uint(ugfx_te_armed ? ugfx_stamp_to_us(ugfx_te_period) : 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ugfx_frame_period_obj, ugfx_frame_period);
+
+/// \method slab_info()
+///
+/// Returns a list of (slot_size, slabs, in_use, peak, allocs) for each size
+/// class of the allocator behind widgets, fonts and image decoders.
+///
+STATIC mp_obj_t ugfx_slab_info(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (int i = 0; i < UGFX_SLAB_CLASSES; i++) {
+        ugfx_slab_stats_t stats;
+        ugfx_heap_slab_stats(i, &stats);
+        mp_obj_t entry[5] = {
+            mp_obj_new_int_from_uint(stats.slot_size),
+            mp_obj_new_int_from_uint(stats.slabs),
+            mp_obj_new_int_from_uint(stats.in_use),
+            mp_obj_new_int_from_uint(stats.peak),
+            mp_obj_new_int_from_uint(stats.allocs),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(5, entry));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(ugfx_slab_info_obj, ugfx_slab_info);
+
 
 
 
@@ -745,10 +937,98 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_fill_ellipse_obj, 5, 5, ugfx_fil
 
 
 
+/// Polygon points can be given either as a sequence of (x, y) pairs or as a
+/// packed array('h') of x0, y0, x1, y1, ... which is used in place, as it has
+/// the same layout as uGFX's point type.
+///
+/// If the points had to be copied, *alloc is set to the number allocated and
+/// the caller must free them with m_del.
+const point *ugfx_get_points(mp_obj_t points_in, size_t *count, size_t *alloc) {
+	mp_buffer_info_t bufinfo;
+	*alloc = 0;
+
+	if (mp_get_buffer(points_in, &bufinfo, MP_BUFFER_READ)) {
+		if (bufinfo.typecode != 'h')
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_TypeError, "Packed points must be an array('h')"));
+		*count = bufinfo.len / sizeof(point);
+		return bufinfo.buf;
+	}
+
+	mp_obj_t *mp_arr;
+	mp_obj_t *mp_arr2;
+	size_t len;
+	size_t len2;
+	mp_obj_get_array(points_in, &len, &mp_arr);
+
+	point *ar = m_new(point, len);
+	size_t j = 0;
+	for (size_t i = 0; i < len; i++){
+		mp_obj_get_array(mp_arr[i], &len2, &mp_arr2);
+		if (len2 == 2){
+			ar[j].x = mp_obj_get_int(mp_arr2[0]);
+			ar[j].y = mp_obj_get_int(mp_arr2[1]);
+			j++;
+		}
+	}
+	*count = j;
+	*alloc = len;
+	return ar;
+}
+
+/// Even-odd scanline fill, so concave and self-intersecting outlines are
+/// filled correctly. Each horizontal run is passed to span().
+void ugfx_fill_poly(coord_t tx, coord_t ty, const point *pts, size_t cnt, ugfx_span_fn_t span, void *ctx) {
+	if (cnt < 3)
+		return;
+
+	coord_t ymin = pts[0].y;
+	coord_t ymax = pts[0].y;
+	for (size_t i = 1; i < cnt; i++){
+		if (pts[i].y < ymin)
+			ymin = pts[i].y;
+		if (pts[i].y > ymax)
+			ymax = pts[i].y;
+	}
+
+	coord_t *xs = m_new(coord_t, cnt);
+
+	for (coord_t y = ymin; y < ymax; y++){
+		size_t n = 0;
+
+		// find where each edge crosses the centre of this row
+		for (size_t i = 0, j = cnt - 1; i < cnt; j = i++){
+			int32_t y0 = pts[j].y, y1 = pts[i].y;
+			if ((y0 <= y) == (y1 <= y))
+				continue;
+			int32_t x0 = pts[j].x, x1 = pts[i].x;
+			coord_t x = x0 + ((2 * (y - y0) + 1) * (x1 - x0)) / (2 * (y1 - y0));
+
+			// insertion sort, edges are few per row
+			size_t k = n++;
+			while (k > 0 && xs[k - 1] > x){
+				xs[k] = xs[k - 1];
+				k--;
+			}
+			xs[k] = x;
+		}
+
+		for (size_t k = 0; k + 1 < n; k += 2){
+			if (xs[k + 1] > xs[k])
+				span(ctx, tx + xs[k], ty + y, xs[k + 1] - xs[k]);
+		}
+	}
+
+	m_del(coord_t, xs, cnt);
+}
+
+STATIC void ugfx_display_span(void *ctx, coord_t x, coord_t y, coord_t cx) {
+	gdispFillArea(x, y, cx, 1, *(color_t *)ctx);
+}
+
 /// \method polygon(x1, y1, array, colour)
 ///
-/// Draw a polygon starting at (x1,y1), using the aarray of points, using the given colour.
-/// Option to round the ends
+/// Draw a polygon starting at (x1,y1), using the array of points, using the given colour.
+/// The points can be a list of (x, y) pairs or a packed array('h') of x, y values.
 ///
 STATIC mp_obj_t ugfx_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     // extract arguments
@@ -757,26 +1037,14 @@ STATIC mp_obj_t ugfx_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     int y0 = mp_obj_get_int(args[1]);
 	int col = mp_obj_get_int(args[3]);
 
-	point ar[20];
+	size_t cnt, alloc;
+	const point *ar = ugfx_get_points(args[2], &cnt, &alloc);
 
-	mp_obj_t *mp_arr;
-	mp_obj_t *mp_arr2;
-	uint len;
-	uint len2;
-	mp_obj_get_array(args[2], &len, &mp_arr);
-
-	if (len <= 20){
-		int i,j;
-		j = 0;
-		for (i = 0; i < len; i++){
-			mp_obj_get_array(mp_arr[i], &len2, &mp_arr2);
-			if (len2 == 2){
-				point p = {mp_obj_get_int(mp_arr2[0]), mp_obj_get_int(mp_arr2[1])};
-				ar[j++] = p;
-			}
-		}
-		gdispDrawPoly(x0, y0, ar, j, col);
-	}
+	if (cnt >= 2)
+		gdispDrawPoly(x0, y0, ar, cnt, col);
+
+	if (alloc)
+		m_del(point, (point *)ar, alloc);
 
     return mp_const_none;
 }
@@ -787,36 +1055,24 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_polygon_obj, 4, 4, ugfx_polygon)
 
 /// \method fill_polygon(x1, y1, array, colour)
 ///
-/// Draw a polygon starting at (x1,y1), using the aarray of points, using the given colour.
-/// Option to round the ends
+/// Fill a polygon starting at (x1,y1), using the array of points, using the given colour.
+/// The outline may be concave. The points can be a list of (x, y) pairs or a
+/// packed array('h') of x, y values.
 ///
 STATIC mp_obj_t ugfx_fill_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     // extract arguments
     //ugfx_obj_t *self = args[0];
     int x0 = mp_obj_get_int(args[0]);
     int y0 = mp_obj_get_int(args[1]);
-	int col = mp_obj_get_int(args[3]);
+	color_t col = mp_obj_get_int(args[3]);
 
-	point ar[20];
+	size_t cnt, alloc;
+	const point *ar = ugfx_get_points(args[2], &cnt, &alloc);
 
-	mp_obj_t *mp_arr;
-	mp_obj_t *mp_arr2;
-	uint len;
-	uint len2;
-	mp_obj_get_array(args[2], &len, &mp_arr);
-
-	if (len <= 20){
-		int i,j;
-		j = 0;
-		for (i = 0; i < len; i++){
-			mp_obj_get_array(mp_arr[i], &len2, &mp_arr2);
-			if (len2 == 2){
-				point p = {mp_obj_get_int(mp_arr2[0]), mp_obj_get_int(mp_arr2[1])};
-				ar[j++] = p;
-			}
-		}
-		gdispFillConvexPoly(x0, y0, ar, i, col);
-	}
+	ugfx_fill_poly(x0, y0, ar, cnt, ugfx_display_span, &col);
+
+	if (alloc)
+		m_del(point, (point *)ar, alloc);
 
     return mp_const_none;
 }
@@ -875,6 +1131,113 @@ STATIC mp_obj_t ugfx_box(mp_uint_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_box_obj, 5, 5, ugfx_box);
 
 
+/// Opcodes for draw_batch(). Each is followed by the same arguments, in the
+/// same order, as the matching module function.
+enum {
+    BATCH_END = 0,      // stops the batch early
+    BATCH_PIXEL,        // x, y, colour
+    BATCH_LINE,         // x1, y1, x2, y2, colour
+    BATCH_THICKLINE,    // x1, y1, x2, y2, colour, width, round
+    BATCH_BOX,          // x, y, a, b, colour
+    BATCH_AREA,         // x, y, a, b, colour
+    BATCH_CIRCLE,       // x, y, r, colour
+    BATCH_FILL_CIRCLE,  // x, y, r, colour
+    BATCH_ELLIPSE,      // x, y, a, b, colour
+    BATCH_FILL_ELLIPSE, // x, y, a, b, colour
+    BATCH_ARC,          // x, y, r, angle1, angle2, colour
+    BATCH_FILL_ARC,     // x, y, r, angle1, angle2, colour
+    BATCH_MAX
+};
+
+STATIC const uint8_t batch_arg_count[BATCH_MAX] = {
+    [BATCH_END] = 0,
+    [BATCH_PIXEL] = 3,
+    [BATCH_LINE] = 5,
+    [BATCH_THICKLINE] = 7,
+    [BATCH_BOX] = 5,
+    [BATCH_AREA] = 5,
+    [BATCH_CIRCLE] = 4,
+    [BATCH_FILL_CIRCLE] = 4,
+    [BATCH_ELLIPSE] = 5,
+    [BATCH_FILL_ELLIPSE] = 5,
+    [BATCH_ARC] = 6,
+    [BATCH_FILL_ARC] = 6,
+};
+
+/// \method draw_batch(buffer, {dx, dy})
+///
+/// Draw a packed list of primitives in one call. `buffer` is an array('h')
+/// of opcodes (ugfx.BATCH_LINE, ...) each followed by its arguments; colours
+/// are stored as their 16 bit value. The whole list is drawn without
+/// returning to the VM and flushed once. The same buffer can be kept and
+/// replayed each frame, optionally offset by (dx, dy).
+/// Returns the number of primitives drawn.
+///
+STATIC mp_obj_t ugfx_draw_batch(mp_uint_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    coord_t dx = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    coord_t dy = n_args > 2 ? mp_obj_get_int(args[2]) : 0;
+
+    const int16_t *cmd = bufinfo.buf;
+    const int16_t *end = cmd + bufinfo.len / sizeof(int16_t);
+    int count = 0;
+
+    while (cmd < end) {
+        uint16_t op = *cmd;
+        if (op == BATCH_END)
+            break;
+        if (op >= BATCH_MAX || cmd + batch_arg_count[op] >= end)
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Bad batch command at %d", (int)(cmd - (const int16_t *)bufinfo.buf)));
+        const int16_t *a = cmd + 1;
+
+        switch (op) {
+            case BATCH_PIXEL:
+                gdispDrawPixel(a[0] + dx, a[1] + dy, (uint16_t)a[2]);
+                break;
+            case BATCH_LINE:
+                gdispDrawLine(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, (uint16_t)a[4]);
+                break;
+            case BATCH_THICKLINE:
+                gdispDrawThickLine(a[0] + dx, a[1] + dy, a[2] + dx, a[3] + dy, (uint16_t)a[4], a[5], a[6] != 0);
+                break;
+            case BATCH_BOX:
+                gdispDrawBox(a[0] + dx, a[1] + dy, a[2], a[3], (uint16_t)a[4]);
+                break;
+            case BATCH_AREA:
+                gdispFillArea(a[0] + dx, a[1] + dy, a[2], a[3], (uint16_t)a[4]);
+                break;
+            case BATCH_CIRCLE:
+                gdispDrawCircle(a[0] + dx, a[1] + dy, a[2], (uint16_t)a[3]);
+                break;
+            case BATCH_FILL_CIRCLE:
+                gdispFillCircle(a[0] + dx, a[1] + dy, a[2], (uint16_t)a[3]);
+                break;
+            case BATCH_ELLIPSE:
+                gdispDrawEllipse(a[0] + dx, a[1] + dy, a[2], a[3], (uint16_t)a[4]);
+                break;
+            case BATCH_FILL_ELLIPSE:
+                gdispFillEllipse(a[0] + dx, a[1] + dy, a[2], a[3], (uint16_t)a[4]);
+                break;
+            case BATCH_ARC:
+                gdispDrawArc(a[0] + dx, a[1] + dy, a[2], a[3], a[4], (uint16_t)a[5]);
+                break;
+            case BATCH_FILL_ARC:
+                gdispFillArc(a[0] + dx, a[1] + dy, a[2], a[3], a[4], (uint16_t)a[5]);
+                break;
+        }
+        cmd += 1 + batch_arg_count[op];
+        count++;
+    }
+
+    gdispFlush();
+
+    return mp_obj_new_int(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_draw_batch_obj, 1, 3, ugfx_draw_batch);
+
+
 /*
 /// \method next()
 ///
@@ -1010,6 +1373,7 @@ STATIC const mp_map_elem_t ugfx_module_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_polygon), (mp_obj_t)&ugfx_polygon_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_fill_polygon), (mp_obj_t)&ugfx_fill_polygon_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_display_image), (mp_obj_t)&ugfx_display_image_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_draw_batch), (mp_obj_t)&ugfx_draw_batch_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_orientation), (mp_obj_t)&ugfx_set_orientation_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_spi_clk), (mp_obj_t)&ugfx_spi_clk_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_write_command), (mp_obj_t)&ugfx_write_command_obj },
@@ -1019,6 +1383,10 @@ STATIC const mp_map_elem_t ugfx_module_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_disable_tear), (mp_obj_t)&ugfx_disable_tear_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_enable_tear), (mp_obj_t)&ugfx_enable_tear_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_set_tear_line), (mp_obj_t)&ugfx_set_tear_line_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_present), (mp_obj_t)&ugfx_present_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_frame_sync), (mp_obj_t)&ugfx_frame_sync_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_frame_period), (mp_obj_t)&ugfx_frame_period_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_slab_info), (mp_obj_t)&ugfx_slab_info_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_ball_demo), (mp_obj_t)&ugfx_ball_demo_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_get_pixel), (mp_obj_t)&ugfx_get_pixel_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_set_default_font), (mp_obj_t)&ugfx_set_default_font_obj },
@@ -1037,6 +1405,10 @@ STATIC const mp_map_elem_t ugfx_module_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_stream_color), (mp_obj_t)&ugfx_stream_color_obj },
     { MP_OBJ_NEW_QSTR(MP_QSTR_stream_stop), (mp_obj_t)&ugfx_stream_stop_obj },
 
+    // sprite layer
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sprite_background), (mp_obj_t)&ugfx_sprite_background_obj },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_sprite_draw_all), (mp_obj_t)&ugfx_sprite_draw_all_obj },
+
 	//class constants
     { MP_OBJ_NEW_QSTR(MP_QSTR_RED),        MP_OBJ_NEW_SMALL_INT(Red) },
     { MP_OBJ_NEW_QSTR(MP_QSTR_BLUE),       MP_OBJ_NEW_SMALL_INT(Blue) },
@@ -1071,6 +1443,20 @@ STATIC const mp_map_elem_t ugfx_module_dict_table[] = {
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_FONT_MEDIUM_BOLD),   MP_OBJ_NEW_SMALL_INT(4) },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_FONT_FIXED),   MP_OBJ_NEW_SMALL_INT(5) },
 	{ MP_OBJ_NEW_QSTR(MP_QSTR_FONT_FIXED_LG),   MP_OBJ_NEW_SMALL_INT(6) },
+
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_END),          MP_OBJ_NEW_SMALL_INT(BATCH_END) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_PIXEL),        MP_OBJ_NEW_SMALL_INT(BATCH_PIXEL) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_LINE),         MP_OBJ_NEW_SMALL_INT(BATCH_LINE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_THICKLINE),    MP_OBJ_NEW_SMALL_INT(BATCH_THICKLINE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_BOX),          MP_OBJ_NEW_SMALL_INT(BATCH_BOX) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_AREA),         MP_OBJ_NEW_SMALL_INT(BATCH_AREA) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_CIRCLE),       MP_OBJ_NEW_SMALL_INT(BATCH_CIRCLE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_FILL_CIRCLE),  MP_OBJ_NEW_SMALL_INT(BATCH_FILL_CIRCLE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_ELLIPSE),      MP_OBJ_NEW_SMALL_INT(BATCH_ELLIPSE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_FILL_ELLIPSE), MP_OBJ_NEW_SMALL_INT(BATCH_FILL_ELLIPSE) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_ARC),          MP_OBJ_NEW_SMALL_INT(BATCH_ARC) },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_BATCH_FILL_ARC),     MP_OBJ_NEW_SMALL_INT(BATCH_FILL_ARC) },
+
     { MP_OBJ_NEW_QSTR(MP_QSTR_Button), (mp_obj_t)&ugfx_button_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Container), (mp_obj_t)&ugfx_container_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Graph), (mp_obj_t)&ugfx_graph_type },
@@ -1083,6 +1469,7 @@ STATIC const mp_map_elem_t ugfx_module_dict_table[] = {
     { MP_OBJ_NEW_QSTR(MP_QSTR_Image), (mp_obj_t)&ugfx_image_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Checkbox), (mp_obj_t)&ugfx_checkbox_type },
     { MP_OBJ_NEW_QSTR(MP_QSTR_Imagebox), (mp_obj_t)&ugfx_imagebox_type },
+    { MP_OBJ_NEW_QSTR(MP_QSTR_Sprite), (mp_obj_t)&ugfx_sprite_type },
 };
 
 STATIC MP_DEFINE_CONST_DICT (
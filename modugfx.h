@@ -28,5 +28,11 @@
 #include "modugfx/ugfx_widgets.h"
 #include "modugfx/ugfx_containers.h"
 #include "modugfx/ugfx_styles.h"
+#include "modugfx/ugfx_sprites.h"
 
 extern const mp_obj_type_t ugfx_type;
+
+typedef void (*ugfx_span_fn_t)(void *ctx, coord_t x, coord_t y, coord_t cx);
+
+const point *ugfx_get_points(mp_obj_t points_in, size_t *count, size_t *alloc);
+void ugfx_fill_poly(coord_t tx, coord_t ty, const point *pts, size_t cnt, ugfx_span_fn_t span, void *ctx);
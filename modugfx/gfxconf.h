@@ -49,7 +49,7 @@
 	#define CORTEX_USE_FPU                           TRUE
 //    #define GFX_CPU_NO_ALIGNMENT_FAULTS              FALSE
 //    #define GFX_CPU_ENDIAN                           GFX_CPU_ENDIAN_UNKNOWN
-    #define GFX_OS_HEAP_SIZE                         630000
+//    #define GFX_OS_HEAP_SIZE                         0
 //    #define GFX_OS_NO_INIT                           FALSE
     #define GFX_OS_INIT_NO_WARNING                   TRUE
 //    #define GFX_OS_PRE_INIT_FUNCTION                 myHardwareInitRoutine
@@ -57,6 +57,12 @@
 //    #define GFX_OS_EXTRA_DEINIT_FUNCTION             myOSDeInitRoutine
 //    #define GFX_EMULATE_MALLOC                       TRUE
 
+// Allocate from the uGFX pool in SDRAM (MICROPY_HW_UGFX_HEAP_SIZE)
+#include "ugfx_heap.h"
+#define gfxAlloc(sz)                                 ugfx_heap_alloc(sz)
+#define gfxRealloc(p,osz,nsz)                        ugfx_heap_realloc(p, osz, nsz)
+#define gfxFree(ptr)                                 ugfx_heap_free(ptr)
+
 
 ///////////////////////////////////////////////////////////////////////////
 // GDISP                                                                 //
@@ -281,7 +287,7 @@
 //    #define GKEYBOARD_LAYOUT_OFF                     FALSE
 //        #define GKEYBOARD_LAYOUT_SCANCODE2_US        FALSE
 #define GINPUT_NEED_TOGGLE                           TRUE
-#define GINPUT_TOGGLE_POLL_PERIOD    40
+#define GINPUT_TOGGLE_POLL_PERIOD    TIME_INFINITE   // woken by the button interrupts
 //#define GINPUT_NEED_DIAL                             FALSE
 
 
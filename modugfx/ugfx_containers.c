@@ -309,8 +309,8 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_box_obj, 6, 6, ugfx_box);
 
 /// \method polygon(x1, y1, array, colour)
 ///
-/// Draw a polygon starting at (x1,y1), using the aarray of points, using the given colour.
-/// Option to round the ends
+/// Draw a polygon starting at (x1,y1), using the array of points, using the given colour.
+/// The points can be a list of (x, y) pairs or a packed array('h') of x, y values.
 ///
 STATIC mp_obj_t ugfx_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     // extract arguments
@@ -319,38 +319,32 @@ STATIC mp_obj_t ugfx_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     int y0 = mp_obj_get_int(args[2]);
 	int col = mp_obj_get_int(args[4]);
 
-	point ar[20];
-
-	mp_obj_t *mp_arr;
-	mp_obj_t *mp_arr2;
-	uint len;
-	uint len2;
-	mp_obj_get_array(args[3], &len, &mp_arr);
-
-	if (len <= 20){
-		int i,j;
-		j = 0;
-		for (i = 0; i < len; i++){
-			mp_obj_get_array(mp_arr[i], &len2, &mp_arr2);
-			if (len2 == 2){
-				point p = {mp_obj_get_int(mp_arr2[0]), mp_obj_get_int(mp_arr2[1])};
-				ar[j++] = p;
-			}
-		}
+	size_t cnt, alloc;
+	const point *ar = ugfx_get_points(args[3], &cnt, &alloc);
+
+	if (cnt >= 2){
 		GHandle gh = get_ugfx_handle(args[0]);
 		gwinSetColor(gh,col);
-		gwinDrawPoly(gh, x0, y0, ar, i);
+		gwinDrawPoly(gh, x0, y0, ar, cnt);
 	}
 
+	if (alloc)
+		m_del(point, (point *)ar, alloc);
+
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_polygon_obj, 5, 5, ugfx_polygon);
 
 
+STATIC void ugfx_window_span(void *ctx, coord_t x, coord_t y, coord_t cx) {
+	gwinFillArea((GHandle)ctx, x, y, cx, 1);
+}
+
 /// \method fill_polygon(x1, y1, array, colour)
 ///
-/// Draw a polygon starting at (x1,y1), using the aarray of points, using the given colour.
-/// Option to round the ends
+/// Fill a polygon starting at (x1,y1), using the array of points, using the given colour.
+/// The outline may be concave. The points can be a list of (x, y) pairs or a
+/// packed array('h') of x, y values.
 ///
 STATIC mp_obj_t ugfx_fill_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     // extract arguments
@@ -359,28 +353,15 @@ STATIC mp_obj_t ugfx_fill_polygon(mp_uint_t n_args, const mp_obj_t *args) {
     int y0 = mp_obj_get_int(args[2]);
 	int col = mp_obj_get_int(args[4]);
 
-	point ar[20];
-
-	mp_obj_t *mp_arr;
-	mp_obj_t *mp_arr2;
-	uint len;
-	uint len2;
-	mp_obj_get_array(args[3], &len, &mp_arr);
-
-	if (len <= 20){
-		int i,j;
-		j = 0;
-		for (i = 0; i < len; i++){
-			mp_obj_get_array(mp_arr[i], &len2, &mp_arr2);
-			if (len2 == 2){
-				point p = {mp_obj_get_int(mp_arr2[0]), mp_obj_get_int(mp_arr2[1])};
-				ar[j++] = p;
-			}
-		}
-		GHandle gh = get_ugfx_handle(args[0]);
-		gwinSetColor(gh,col);
-		gwinFillConvexPoly(gh, x0, y0, ar, i);
-	}
+	size_t cnt, alloc;
+	const point *ar = ugfx_get_points(args[3], &cnt, &alloc);
+
+	GHandle gh = get_ugfx_handle(args[0]);
+	gwinSetColor(gh,col);
+	ugfx_fill_poly(x0, y0, ar, cnt, ugfx_window_span, gh);
+
+	if (alloc)
+		m_del(point, (point *)ar, alloc);
 
     return mp_const_none;
 }
@@ -730,45 +711,161 @@ STATIC mp_obj_t ugfx_graph_set_arrows(mp_obj_t self_in, mp_obj_t flags) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(ugfx_graph_set_arrows_obj, ugfx_graph_set_arrows);
 
 
-/// \method plot( point(s)_x, point(s)_y, {new_series} )
+// A series passed to plot(): either a list/tuple of ints, or an array('h') /
+// array('f') read in place through the buffer protocol.
+typedef struct _graph_series_t {
+	mp_buffer_info_t buf;
+	mp_obj_t *items;
+	size_t len;
+} graph_series_t;
+
+STATIC void graph_get_series(mp_obj_t obj, graph_series_t *s) {
+	s->items = NULL;
+	if (mp_get_buffer(obj, &s->buf, MP_BUFFER_READ)) {
+		if (s->buf.typecode == 'h')
+			s->len = s->buf.len / sizeof(int16_t);
+		else if (s->buf.typecode == 'f')
+			s->len = s->buf.len / sizeof(float);
+		else
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "array must be of type 'h' or 'f'"));
+	}
+	else
+		mp_obj_get_array(obj, &s->len, &s->items);
+}
+
+STATIC coord_t graph_series_get(const graph_series_t *s, size_t i) {
+	if (s->items)
+		return mp_obj_get_int(s->items[i]);
+	if (s->buf.typecode == 'h')
+		return ((const int16_t *)s->buf.buf)[i];
+	float f = ((const float *)s->buf.buf)[i];
+	return (coord_t)(f < 0 ? f - 0.5f : f + 0.5f);
+}
+
+#define GRAPH_PLOT_CHUNK 32
+
+/// \method plot( point(s)_x, point(s)_y, {new_series}, *, decimate=False )
 ///
-/// Plot either an array, or a point. Optional second parameter specifies whether
+/// Plot either an array, or a point. Optional third parameter specifies whether
 ///    to start a new series or join onto previous
-STATIC mp_obj_t ugfx_graph_plot(mp_uint_t n_args, const mp_obj_t *args) {
-	if (n_args < 3)
-		return mp_const_none;
-    ugfx_graph_obj_t *self = args[0];
+///
+/// x and y may be lists, or array('h')/array('f') which are read without
+///    copying. x may be None to plot y against its index. The series is drawn
+///    as one connected polyline.
+///
+/// With decimate=True, samples landing on the same pixel column are reduced to
+///    their minimum and maximum so peaks survive. If x is None the indices are
+///    also scaled to fit the graph width.
+STATIC mp_obj_t ugfx_graph_plot(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+	enum { ARG_x, ARG_y, ARG_new_series, ARG_decimate };
+	static const mp_arg_t allowed_args[] = {
+		{ MP_QSTR_x, MP_ARG_REQUIRED | MP_ARG_OBJ },
+		{ MP_QSTR_y, MP_ARG_REQUIRED | MP_ARG_OBJ },
+		{ MP_QSTR_new_series, MP_ARG_BOOL, {.u_bool = false} },
+		{ MP_QSTR_decimate, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+	};
+	mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+	mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
-	mp_obj_t *itemsx;
-	mp_obj_t *itemsy;
-	mp_uint_t len1;
-	mp_uint_t len2;
+	ugfx_graph_obj_t *self = pos_args[0];
+	mp_obj_t x_in = args[ARG_x].u_obj;
+	mp_obj_t y_in = args[ARG_y].u_obj;
 
-	if (n_args == 4){
-		if (mp_obj_get_int(args[3]))
-			gwinGraphStartSet(self->ghGraph);
-	}
+	if (args[ARG_new_series].u_bool)
+		gwinGraphStartSet(self->ghGraph);
 
-	//if is array...
-	if (MP_OBJ_IS_INT(args[1]) && MP_OBJ_IS_INT(args[2]))
-		gwinGraphDrawPoint(self->ghGraph, mp_obj_get_int(args[1]),mp_obj_get_int(args[2]));
-	else
-	{
-		mp_obj_get_array(args[1], &len1, &itemsx);
-		mp_obj_get_array(args[2], &len2, &itemsy);
+	if (MP_OBJ_IS_INT(x_in) && MP_OBJ_IS_INT(y_in)) {
+		gwinGraphDrawPoint(self->ghGraph, mp_obj_get_int(x_in), mp_obj_get_int(y_in));
+		return mp_const_none;
+	}
 
-		if (len1 != len2)
+	graph_series_t xs, ys;
+	graph_get_series(y_in, &ys);
+	if (x_in != mp_const_none) {
+		graph_get_series(x_in, &xs);
+		if (xs.len != ys.len)
 			nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Requires x and y to be the same length"));
+	}
 
-		int i;
-		for (i = 0; i < len1; i++){
-			gwinGraphDrawPoint(self->ghGraph, mp_obj_get_int(itemsx[i]), mp_obj_get_int(itemsy[i]));
+	bool decimate = args[ARG_decimate].u_bool;
+	int32_t plot_width = self->ghGraph->width - self->gGObject.xorigin;
+	bool scale_x = decimate && x_in == mp_const_none && ys.len > (size_t)plot_width && plot_width > 0;
+
+	point pts[GRAPH_PLOT_CHUNK];
+	size_t n = 0;
+
+	// current pixel column when decimating
+	bool in_col = false;
+	coord_t col_x = 0, min_y = 0, max_y = 0;
+	bool min_first = true;
+
+	#define PLOT_EMIT(px, py) do { \
+		if (n == GRAPH_PLOT_CHUNK) { \
+			gwinGraphDrawPoints(self->ghGraph, pts, n); \
+			n = 0; \
+		} \
+		pts[n].x = (px); \
+		pts[n].y = (py); \
+		n++; \
+	} while (0)
+
+	#define PLOT_EMIT_COLUMN() do { \
+		if (min_y == max_y) \
+			PLOT_EMIT(col_x, min_y); \
+		else if (min_first) { \
+			PLOT_EMIT(col_x, min_y); \
+			PLOT_EMIT(col_x, max_y); \
+		} \
+		else { \
+			PLOT_EMIT(col_x, max_y); \
+			PLOT_EMIT(col_x, min_y); \
+		} \
+	} while (0)
+
+	for (size_t i = 0; i < ys.len; i++) {
+		coord_t x;
+		if (x_in != mp_const_none)
+			x = graph_series_get(&xs, i);
+		else if (scale_x)
+			x = (int32_t)((int64_t)i * plot_width / ys.len);
+		else
+			x = i;
+		coord_t y = graph_series_get(&ys, i);
+
+		if (!decimate) {
+			PLOT_EMIT(x, y);
+			continue;
 		}
+
+		if (in_col && x == col_x) {
+			if (y < min_y) {
+				min_y = y;
+				min_first = false;
+			}
+			if (y > max_y) {
+				max_y = y;
+				min_first = true;
+			}
+			continue;
+		}
+		if (in_col)
+			PLOT_EMIT_COLUMN();
+		in_col = true;
+		col_x = x;
+		min_y = max_y = y;
+		min_first = true;
 	}
+	if (in_col)
+		PLOT_EMIT_COLUMN();
+	if (n)
+		gwinGraphDrawPoints(self->ghGraph, pts, n);
+
+	#undef PLOT_EMIT_COLUMN
+	#undef PLOT_EMIT
 
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_graph_plot_obj, 3, 4, ugfx_graph_plot);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(ugfx_graph_plot_obj, 3, ugfx_graph_plot);
 
 
 /// \method set_style( thing_to_change, shape, size, colour, {spacing}  )
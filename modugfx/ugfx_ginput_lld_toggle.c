@@ -8,7 +8,10 @@
 
 GINPUT_TOGGLE_DECLARE_STRUCTURE();
 
+// No polling: tilda_thread.c wakes the toggle driver whenever a TCA9555
+// or GPIO button interrupt changes the button state
 void ginput_lld_toggle_init(const GToggleConfig *ptc) {
+	tildaToggleFeedStart();
 }
 
 unsigned ginput_lld_toggle_getbits(const GToggleConfig *ptc) {
@@ -0,0 +1,228 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <xdc/std.h>
+#include <xdc/runtime/Memory.h>
+#include <ti/sysbios/heaps/HeapMem.h>
+#include <ti/sysbios/gates/GateMutex.h>
+#include <ti/sysbios/knl/Task.h>
+
+#include "mpconfigboard.h"
+#include "ugfx_heap.h"
+
+// uGFX used to malloc() from the TI-RTOS heap in internal SRAM, which it
+// shares with the network stack and task stacks, while the SDRAM set
+// aside for it went unused.  Everything it allocates now comes from this
+// pool instead, and machine.heaps() can report on it separately.
+
+#define UGFX_HEAP_ALIGN     (8)
+
+// HeapMem_free() needs the size back, so each block carries it in front.
+// Blocks of up to UGFX_SLAB_MAX_SLOT bytes are slab slots, anything
+// bigger came straight from the HeapMem.
+typedef union _ugfx_block_t {
+    size_t size;
+    union _ugfx_block_t *next;  // while on a slab free list
+    uint8_t align[UGFX_HEAP_ALIGN];
+} ugfx_block_t;
+
+// Widgets, fonts and image decoder state are small and get created and
+// destroyed by the dozen on every screen change.  Carving them out of
+// per-size slabs keeps them from fragmenting the pool: slabs are never
+// given back, so once a screen has been shown once, showing it again
+// doesn't touch the HeapMem at all.
+static const uint16_t slab_slot_size[UGFX_SLAB_CLASSES] = {
+    32, 64, 128, 256, 512,
+};
+
+typedef struct _ugfx_slab_t {
+    ugfx_block_t *free;
+    ugfx_slab_stats_t stats;
+} ugfx_slab_t;
+
+__attribute__((section(".ExternalSRAM"), aligned(UGFX_HEAP_ALIGN)))
+static uint8_t ugfx_pool[MICROPY_HW_UGFX_HEAP_SIZE];
+
+// HeapMem has its own gate, a GateMutex shared with the system heap, so
+// it is only ever called with ours released; ours just covers the slab
+// lists and the counters.
+static HeapMem_Struct heap_struct;
+static HeapMem_Handle heap;
+static GateMutex_Struct gate_struct;
+static GateMutex_Handle gate;
+static size_t heap_used;
+static size_t heap_peak;
+static ugfx_slab_t slabs[UGFX_SLAB_CLASSES];
+
+static void ugfx_heap_init(void) {
+    if (heap != NULL) {
+        return;
+    }
+    // neither construct blocks, so this is safe with the scheduler off
+    UInt key = Task_disable();
+    if (heap == NULL) {
+        GateMutex_construct(&gate_struct, NULL);
+        gate = GateMutex_handle(&gate_struct);
+
+        for (int i = 0; i < UGFX_SLAB_CLASSES; i++) {
+            slabs[i].stats.slot_size = slab_slot_size[i];
+        }
+
+        HeapMem_Params params;
+        HeapMem_Params_init(&params);
+        params.buf = ugfx_pool;
+        params.size = sizeof(ugfx_pool);
+        params.minBlockAlign = UGFX_HEAP_ALIGN;
+        HeapMem_construct(&heap_struct, &params);
+        heap = HeapMem_handle(&heap_struct);
+    }
+    Task_restore(key);
+}
+
+// Called with the gate held
+static void heap_account(size_t size) {
+    heap_used += size;
+    if (heap_used > heap_peak) {
+        heap_peak = heap_used;
+    }
+}
+
+static int slab_class(size_t size) {
+    for (int i = 0; i < UGFX_SLAB_CLASSES; i++) {
+        if (size <= slab_slot_size[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Called with the gate held; returns NULL if the slab needs a refill
+static ugfx_block_t *slab_pop(ugfx_slab_t *slab) {
+    ugfx_block_t *block = slab->free;
+    if (block == NULL) {
+        return NULL;
+    }
+    slab->free = block->next;
+    block->size = slab->stats.slot_size;
+
+    slab->stats.allocs++;
+    if (++slab->stats.in_use > slab->stats.peak) {
+        slab->stats.peak = slab->stats.in_use;
+    }
+    return block;
+}
+
+static ugfx_block_t *slab_alloc(ugfx_slab_t *slab) {
+    IArg key = GateMutex_enter(gate);
+    ugfx_block_t *block = slab_pop(slab);
+    GateMutex_leave(gate, key);
+    if (block != NULL) {
+        return block;
+    }
+
+    uint8_t *mem = HeapMem_alloc(heap, UGFX_SLAB_BYTES, UGFX_HEAP_ALIGN, NULL);
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    key = GateMutex_enter(gate);
+    heap_account(UGFX_SLAB_BYTES);
+    size_t slot = slab->stats.slot_size;
+    for (size_t off = 0; off + slot <= UGFX_SLAB_BYTES; off += slot) {
+        ugfx_block_t *b = (ugfx_block_t *)(mem + off);
+        b->next = slab->free;
+        slab->free = b;
+        slab->stats.slots++;
+    }
+    slab->stats.slabs++;
+    block = slab_pop(slab);
+    GateMutex_leave(gate, key);
+    return block;
+}
+
+void *ugfx_heap_alloc(size_t size) {
+    size_t total = size + sizeof(ugfx_block_t);
+    ugfx_heap_init();
+
+    ugfx_block_t *block;
+    int cls = slab_class(total);
+    if (cls >= 0) {
+        block = slab_alloc(&slabs[cls]);
+    } else {
+        block = HeapMem_alloc(heap, total, UGFX_HEAP_ALIGN, NULL);
+        if (block != NULL) {
+            block->size = total;
+            IArg key = GateMutex_enter(gate);
+            heap_account(total);
+            GateMutex_leave(gate, key);
+        }
+    }
+
+    return block == NULL ? NULL : block + 1;
+}
+
+void ugfx_heap_free(void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    ugfx_block_t *block = (ugfx_block_t *)ptr - 1;
+    size_t size = block->size;
+
+    IArg key = GateMutex_enter(gate);
+    int cls = slab_class(size);
+    if (cls >= 0) {
+        ugfx_slab_t *slab = &slabs[cls];
+        block->next = slab->free;
+        slab->free = block;
+        slab->stats.in_use--;
+    } else {
+        heap_used -= size;
+    }
+    GateMutex_leave(gate, key);
+
+    if (cls < 0) {
+        HeapMem_free(heap, block, size);
+    }
+}
+
+void *ugfx_heap_realloc(void *ptr, size_t old_size, size_t new_size) {
+    if (ptr != NULL && slab_class(new_size + sizeof(ugfx_block_t)) >= 0
+        && ((ugfx_block_t *)ptr - 1)->size >= new_size + sizeof(ugfx_block_t)) {
+        // still fits where it is
+        return ptr;
+    }
+    void *new_ptr = ugfx_heap_alloc(new_size);
+    if (new_ptr != NULL && ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+        ugfx_heap_free(ptr);
+    }
+    return new_ptr;
+}
+
+void ugfx_heap_stats(ugfx_heap_stats_t *stats) {
+    ugfx_heap_init();
+
+    Memory_Stats mem;
+    HeapMem_getStats(heap, &mem);
+    stats->total = mem.totalSize;
+    stats->free = mem.totalFreeSize;
+    stats->largest_free = mem.largestFreeSize;
+    stats->peak_used = heap_peak;
+}
+
+void ugfx_heap_slab_stats(int cls, ugfx_slab_stats_t *stats) {
+    ugfx_heap_init();
+
+    IArg key = GateMutex_enter(gate);
+    *stats = slabs[cls].stats;
+    GateMutex_leave(gate, key);
+}
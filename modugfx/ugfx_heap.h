@@ -0,0 +1,45 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef UGFX_HEAP_INCLUDE_H
+#define UGFX_HEAP_INCLUDE_H
+
+#include <stddef.h>
+
+// gfxAlloc() and friends, see gfxconf.h.  uGFX objects outlive soft
+// resets (gfxInit only runs once) so they can't go on the GC heap; they
+// come from a fixed pool in SDRAM next to it instead.
+extern void *ugfx_heap_alloc(size_t size);
+extern void *ugfx_heap_realloc(void *ptr, size_t old_size, size_t new_size);
+extern void ugfx_heap_free(void *ptr);
+
+typedef struct _ugfx_heap_stats_t {
+    size_t total;
+    size_t free;
+    size_t largest_free;
+    size_t peak_used;
+} ugfx_heap_stats_t;
+
+extern void ugfx_heap_stats(ugfx_heap_stats_t *stats);
+
+// Small blocks are served from per-size slabs, each UGFX_SLAB_BYTES
+#define UGFX_SLAB_CLASSES   (5)
+#define UGFX_SLAB_BYTES     (4096)
+
+typedef struct _ugfx_slab_stats_t {
+    size_t slot_size;
+    size_t slabs;
+    size_t slots;
+    size_t in_use;
+    size_t peak;
+    size_t allocs;
+} ugfx_slab_stats_t;
+
+extern void ugfx_heap_slab_stats(int cls, ugfx_slab_stats_t *stats);
+
+#endif
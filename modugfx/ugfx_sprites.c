@@ -0,0 +1,440 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013, 2014 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "py/nlr.h"
+#include "py/runtime.h"
+#include "py/objlist.h"
+
+#if MICROPY_HW_HAS_UGFX
+
+#include "modugfx.h"
+
+/// \moduleref ugfx
+///
+/// Sprites are composed in C into a strip buffer and sent to the display
+/// with gdispBlitArea, so a frame costs one window write per dirty strip
+/// rather than a VM call per pixel.
+///
+///     s = ugfx.Sprite(pixels, 16, 16, key=ugfx.BLACK, scale=2)
+///     s.move(10, 20)
+///     s.show()
+///     ugfx.sprite_draw_all()
+///
+/// Areas uncovered by a moved sprite are restored from the sprite background
+/// set with ugfx.sprite_background(), as the panel cannot be read back.
+
+
+typedef struct _sprite_rect_t {
+	coord_t x0, y0, x1, y1;
+} sprite_rect_t;
+
+STATIC pixel_t sprite_strip[UGFX_SPRITE_STRIP_PIXELS];
+STATIC color_t sprite_bg_color = Black;
+STATIC coord_t sprite_bg_width;
+
+void ugfx_sprites_init0(void) {
+	MP_STATE_PORT(ugfx_sprite_list) = mp_obj_new_list(0, NULL);
+	MP_STATE_PORT(ugfx_sprite_background) = MP_OBJ_NULL;
+	sprite_bg_color = Black;
+	sprite_bg_width = 0;
+}
+
+STATIC const pixel_t *sprite_get_pixels(mp_obj_t image, size_t min_len) {
+	mp_buffer_info_t bufinfo;
+	mp_get_buffer_raise(image, &bufinfo, MP_BUFFER_READ);
+	if (bufinfo.len < min_len * sizeof(pixel_t))
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Image buffer too small"));
+	return bufinfo.buf;
+}
+
+STATIC bool sprite_rect_overlaps(const sprite_rect_t *a, const sprite_rect_t *b) {
+	return a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1;
+}
+
+STATIC void sprite_compose_background(coord_t x, coord_t y, coord_t cx, coord_t cy) {
+	pixel_t *dst = sprite_strip;
+	mp_obj_t bg = MP_STATE_PORT(ugfx_sprite_background);
+
+	if (bg == MP_OBJ_NULL) {
+		for (int i = cx * cy; i > 0; i--)
+			*dst++ = sprite_bg_color;
+		return;
+	}
+
+	mp_buffer_info_t bufinfo;
+	mp_get_buffer_raise(bg, &bufinfo, MP_BUFFER_READ);
+	const pixel_t *src = bufinfo.buf;
+	coord_t bg_height = bufinfo.len / sizeof(pixel_t) / sprite_bg_width;
+
+	for (coord_t row = y; row < y + cy; row++) {
+		for (coord_t col = x; col < x + cx; col++) {
+			if (row < bg_height && col < sprite_bg_width)
+				*dst++ = src[row * sprite_bg_width + col];
+			else
+				*dst++ = sprite_bg_color;
+		}
+	}
+}
+
+STATIC void sprite_compose(ugfx_sprite_obj_t *spr, const sprite_rect_t *r) {
+	coord_t sx1 = spr->x + spr->width * spr->scale;
+	coord_t sy1 = spr->y + spr->height * spr->scale;
+	coord_t x0 = MAX(spr->x, r->x0);
+	coord_t y0 = MAX(spr->y, r->y0);
+	coord_t x1 = MIN(sx1, r->x1);
+	coord_t y1 = MIN(sy1, r->y1);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+	const pixel_t *src = sprite_get_pixels(spr->image, spr->width * spr->height);
+	coord_t stride = r->x1 - r->x0;
+
+	for (coord_t y = y0; y < y1; y++) {
+		const pixel_t *line = src + ((y - spr->y) / spr->scale) * spr->width;
+		pixel_t *dst = sprite_strip + (y - r->y0) * stride + (x0 - r->x0);
+		if (spr->scale == 1 && !spr->keyed) {
+			memcpy(dst, line + (x0 - spr->x), (x1 - x0) * sizeof(pixel_t));
+			continue;
+		}
+		for (coord_t x = x0; x < x1; x++, dst++) {
+			pixel_t p = line[(x - spr->x) / spr->scale];
+			if (!spr->keyed || p != spr->key)
+				*dst = p;
+		}
+	}
+}
+
+// Compose and blit one dirty rectangle in strips that fit sprite_strip
+STATIC void sprite_draw_rect(mp_obj_list_t *list, const sprite_rect_t *r) {
+	coord_t cx = r->x1 - r->x0;
+	coord_t rows = UGFX_SPRITE_STRIP_PIXELS / cx;
+
+	for (coord_t y = r->y0; y < r->y1; y += rows) {
+		sprite_rect_t strip = { r->x0, y, r->x1, MIN(y + rows, r->y1) };
+		coord_t cy = strip.y1 - strip.y0;
+
+		sprite_compose_background(strip.x0, strip.y0, cx, cy);
+		for (size_t i = 0; i < list->len; i++) {
+			ugfx_sprite_obj_t *spr = MP_OBJ_TO_PTR(list->items[i]);
+			if (spr->visible)
+				sprite_compose(spr, &strip);
+		}
+		gdispBlitAreaEx(strip.x0, strip.y0, cx, cy, 0, 0, cx, sprite_strip);
+	}
+}
+
+
+/////////////////////////////////////////////////////
+/////////////////////////////////////////////////////
+////////////////      Sprite      ///////////////////
+/////////////////////////////////////////////////////
+/////////////////////////////////////////////////////
+
+
+// scale is kept in a uint8_t
+static void sprite_check_scale(mp_int_t scale) {
+	if (scale < 1 || scale > 255)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Scale must be 1 to 255"));
+}
+
+/// \classmethod \constructor(image, width, height, *, key=None, scale=1)
+///
+/// Construct a Sprite from a buffer of width*height ugfx colours, e.g. array('H').
+/// Pixels equal to `key` are transparent. Need to call .show() after creation
+STATIC const mp_arg_t ugfx_sprite_make_new_args[] = {
+    { MP_QSTR_image, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_width, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_height, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    { MP_QSTR_scale, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+};
+#define UGFX_SPRITE_MAKE_NEW_NUM_ARGS MP_ARRAY_SIZE(ugfx_sprite_make_new_args)
+
+STATIC mp_obj_t ugfx_sprite_make_new(const mp_obj_type_t *type, mp_uint_t n_args, mp_uint_t n_kw, const mp_obj_t *args) {
+    // check arguments
+    mp_arg_val_t vals[UGFX_SPRITE_MAKE_NEW_NUM_ARGS];
+    mp_arg_parse_all_kw_array(n_args, n_kw, args, UGFX_SPRITE_MAKE_NEW_NUM_ARGS, ugfx_sprite_make_new_args, vals);
+
+	if (vals[1].u_int <= 0 || vals[2].u_int <= 0)
+		nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid sprite size"));
+	sprite_check_scale(vals[4].u_int);
+
+    // create sprite object
+    ugfx_sprite_obj_t *spr = m_new_obj(ugfx_sprite_obj_t);
+    spr->base.type = &ugfx_sprite_type;
+
+	spr->width = vals[1].u_int;
+	spr->height = vals[2].u_int;
+	spr->image = vals[0].u_obj;
+	sprite_get_pixels(spr->image, spr->width * spr->height);
+
+	spr->scale = vals[4].u_int;
+	spr->keyed = (vals[3].u_obj != mp_const_none);
+	spr->key = spr->keyed ? mp_obj_get_int(vals[3].u_obj) : 0;
+
+	spr->x = spr->y = 0;
+	spr->drawn_x = spr->drawn_y = spr->drawn_cx = spr->drawn_cy = 0;
+	spr->visible = false;
+	spr->listed = false;
+	spr->on_screen = false;
+	spr->dirty = false;
+
+	return spr;
+}
+
+/// \method move(x, y)
+///
+/// Sets the position the sprite is drawn at on the next ugfx.sprite_draw_all()
+STATIC mp_obj_t ugfx_sprite_move(mp_obj_t self_in, mp_obj_t x_in, mp_obj_t y_in) {
+    ugfx_sprite_obj_t *self = self_in;
+
+	coord_t x = mp_obj_get_int(x_in);
+	coord_t y = mp_obj_get_int(y_in);
+	if (x != self->x || y != self->y) {
+		self->x = x;
+		self->y = y;
+		self->dirty = true;
+	}
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(ugfx_sprite_move_obj, ugfx_sprite_move);
+
+/// \method image(buffer)
+///
+/// Replaces the sprite pixels, e.g. for the next animation frame. The new
+/// buffer must have the same dimensions
+STATIC mp_obj_t ugfx_sprite_image(mp_obj_t self_in, mp_obj_t image) {
+    ugfx_sprite_obj_t *self = self_in;
+
+	sprite_get_pixels(image, self->width * self->height);
+	self->image = image;
+	self->dirty = true;
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ugfx_sprite_image_obj, ugfx_sprite_image);
+
+/// \method scale({n})
+///
+/// Gets or sets the integer scale factor
+STATIC mp_obj_t ugfx_sprite_scale(mp_uint_t n_args, const mp_obj_t *args) {
+    ugfx_sprite_obj_t *self = args[0];
+	if (n_args == 1)
+		return mp_obj_new_int(self->scale);
+
+	mp_int_t scale = mp_obj_get_int(args[1]);
+	sprite_check_scale(scale);
+	self->scale = scale;
+	self->dirty = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_sprite_scale_obj, 1, 2, ugfx_sprite_scale);
+
+/// \method show()
+///
+/// Adds the sprite on top of the sprites already shown
+STATIC mp_obj_t ugfx_sprite_show(mp_obj_t self_in) {
+    ugfx_sprite_obj_t *self = self_in;
+
+	if (!self->listed) {
+		mp_obj_list_append(MP_STATE_PORT(ugfx_sprite_list), self_in);
+		self->listed = true;
+	}
+	self->visible = true;
+	self->dirty = true;
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_sprite_show_obj, ugfx_sprite_show);
+
+/// \method hide()
+///
+/// Removes the sprite; its area is restored on the next draw
+STATIC mp_obj_t ugfx_sprite_hide(mp_obj_t self_in) {
+    ugfx_sprite_obj_t *self = self_in;
+
+	if (self->visible) {
+		self->visible = false;
+		self->dirty = true;
+	}
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_sprite_hide_obj, ugfx_sprite_hide);
+
+/// \method x()
+///
+STATIC mp_obj_t ugfx_sprite_x(mp_obj_t self_in) {
+    return mp_obj_new_int(((ugfx_sprite_obj_t *)self_in)->x);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_sprite_x_obj, ugfx_sprite_x);
+
+/// \method y()
+///
+STATIC mp_obj_t ugfx_sprite_y(mp_obj_t self_in) {
+    return mp_obj_new_int(((ugfx_sprite_obj_t *)self_in)->y);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ugfx_sprite_y_obj, ugfx_sprite_y);
+
+
+STATIC const mp_map_elem_t ugfx_sprite_locals_dict_table[] = {
+    // instance methods
+    { MP_OBJ_NEW_QSTR(MP_QSTR_move), (mp_obj_t)&ugfx_sprite_move_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_image), (mp_obj_t)&ugfx_sprite_image_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_scale), (mp_obj_t)&ugfx_sprite_scale_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_show), (mp_obj_t)&ugfx_sprite_show_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_hide), (mp_obj_t)&ugfx_sprite_hide_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_x), (mp_obj_t)&ugfx_sprite_x_obj},
+    { MP_OBJ_NEW_QSTR(MP_QSTR_y), (mp_obj_t)&ugfx_sprite_y_obj},
+};
+
+STATIC MP_DEFINE_CONST_DICT(ugfx_sprite_locals_dict, ugfx_sprite_locals_dict_table);
+
+const mp_obj_type_t ugfx_sprite_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Sprite,
+    .make_new = ugfx_sprite_make_new,
+    .locals_dict = (mp_obj_t)&ugfx_sprite_locals_dict,
+};
+
+
+/////////////////////////////////////////////////////
+/////////////////////////////////////////////////////
+////////////////   Sprite layer   ///////////////////
+/////////////////////////////////////////////////////
+/////////////////////////////////////////////////////
+
+
+/// \method sprite_background(colour | buffer, {width})
+///
+/// Sets what is drawn under sprites: a single colour, or a buffer of ugfx
+/// colours `width` pixels wide (normally the whole screen)
+STATIC mp_obj_t ugfx_sprite_background(mp_uint_t n_args, const mp_obj_t *args) {
+	if (MP_OBJ_IS_INT(args[0])) {
+		sprite_bg_color = mp_obj_get_int(args[0]);
+		MP_STATE_PORT(ugfx_sprite_background) = MP_OBJ_NULL;
+	} else {
+		if (n_args < 2)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Requires the background width"));
+		coord_t width = mp_obj_get_int(args[1]);
+		if (width <= 0)
+			nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "Invalid background width"));
+		sprite_get_pixels(args[0], width);
+		sprite_bg_width = width;
+		MP_STATE_PORT(ugfx_sprite_background) = args[0];
+	}
+	return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_sprite_background_obj, 1, 2, ugfx_sprite_background);
+
+/// \method sprite_draw_all()
+///
+/// Draws every sprite that moved, changed or was hidden since the last call.
+/// The old and new areas are merged into rectangles which are each composed
+/// once (background, then sprites in show() order) and blitted to the display.
+STATIC mp_obj_t ugfx_sprite_draw_all(void) {
+	mp_obj_list_t *list = MP_OBJ_TO_PTR(MP_STATE_PORT(ugfx_sprite_list));
+	coord_t width = gdispGetWidth();
+	coord_t height = gdispGetHeight();
+
+	if (list->len == 0)
+		return mp_const_none;
+
+	// each sprite contributes at most its old and its new area
+	sprite_rect_t *rects = m_new(sprite_rect_t, list->len * 2);
+	size_t n_rects = 0;
+
+	for (size_t i = 0; i < list->len; i++) {
+		ugfx_sprite_obj_t *spr = MP_OBJ_TO_PTR(list->items[i]);
+		if (!spr->dirty)
+			continue;
+		if (spr->on_screen) {
+			sprite_rect_t r = { spr->drawn_x, spr->drawn_y, spr->drawn_x + spr->drawn_cx, spr->drawn_y + spr->drawn_cy };
+			rects[n_rects++] = r;
+		}
+		if (spr->visible) {
+			sprite_rect_t r = { spr->x, spr->y, spr->x + spr->width * spr->scale, spr->y + spr->height * spr->scale };
+			rects[n_rects++] = r;
+		}
+	}
+
+	// merge overlapping areas so no pixel is sent twice in a frame
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (size_t i = 0; i < n_rects; i++) {
+			for (size_t j = i + 1; j < n_rects; j++) {
+				if (sprite_rect_overlaps(&rects[i], &rects[j])) {
+					rects[i].x0 = MIN(rects[i].x0, rects[j].x0);
+					rects[i].y0 = MIN(rects[i].y0, rects[j].y0);
+					rects[i].x1 = MAX(rects[i].x1, rects[j].x1);
+					rects[i].y1 = MAX(rects[i].y1, rects[j].y1);
+					rects[j--] = rects[--n_rects];
+					merged = true;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < n_rects; i++) {
+		sprite_rect_t r = rects[i];
+		r.x0 = MAX(r.x0, 0);
+		r.y0 = MAX(r.y0, 0);
+		r.x1 = MIN(r.x1, width);
+		r.y1 = MIN(r.y1, height);
+		if (r.x0 < r.x1 && r.y0 < r.y1)
+			sprite_draw_rect(list, &r);
+	}
+	m_del(sprite_rect_t, rects, list->len * 2);
+
+	// record what is now on the display and drop hidden sprites
+	size_t kept = 0;
+	for (size_t i = 0; i < list->len; i++) {
+		ugfx_sprite_obj_t *spr = MP_OBJ_TO_PTR(list->items[i]);
+		spr->dirty = false;
+		spr->on_screen = spr->visible;
+		if (spr->visible) {
+			spr->drawn_x = spr->x;
+			spr->drawn_y = spr->y;
+			spr->drawn_cx = spr->width * spr->scale;
+			spr->drawn_cy = spr->height * spr->scale;
+			list->items[kept++] = list->items[i];
+		} else {
+			spr->listed = false;
+		}
+	}
+	while (list->len > kept)
+		list->items[--list->len] = MP_OBJ_NULL;
+
+	return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(ugfx_sprite_draw_all_obj, ugfx_sprite_draw_all);
+
+#endif // MICROPY_HW_HAS_UGFX
@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Micro Python project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2013, 2014 Damien P. George
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+extern const mp_obj_type_t ugfx_sprite_type;
+
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(ugfx_sprite_background_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(ugfx_sprite_draw_all_obj);
+
+// number of pixels composed in one strip before it is sent to the display
+#define UGFX_SPRITE_STRIP_PIXELS    (320 * 8)
+
+typedef struct _ugfx_sprite_t {
+    mp_obj_base_t base;
+
+	mp_obj_t image;         // RGB565 pixel buffer, fetched again on every draw
+	coord_t width;
+	coord_t height;
+	uint8_t scale;
+	bool keyed;
+	color_t key;
+
+	coord_t x;              // position for the next frame
+	coord_t y;
+	coord_t drawn_x;        // area currently covered on the display
+	coord_t drawn_y;
+	coord_t drawn_cx;
+	coord_t drawn_cy;
+
+	bool visible;
+	bool listed;            // held in the sprite list root pointer
+	bool on_screen;
+	bool dirty;
+
+} ugfx_sprite_obj_t;
+
+void ugfx_sprites_init0(void);
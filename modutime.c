@@ -71,14 +71,31 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(time_localtime_obj, 0, 1, time_localtime);
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Semaphore.h>
 
+#include "modmachine.h"
+
 extern Semaphore_Handle machine_sleep_sem;
 
+// Ends early on an interrupt, except a machine.Timer tick: that only runs
+// the callbacks it scheduled and goes back to sleep until the deadline.
 static void intr_sleep(uint32_t ticks) {
-    if (machine_sleep_sem) {
-        Semaphore_pend(machine_sleep_sem, ticks);
-    }
-    else {
+    if (!machine_sleep_sem) {
         Task_sleep(ticks);
+        return;
+    }
+
+    uint32_t start = Clock_getTicks();
+    uint32_t left = ticks;
+    machine_wake_take();
+    while (Semaphore_pend(machine_sleep_sem, left)
+        && (machine_wake_take() & ~MACHINE_WAKE_BIT(MACHINE_TIMER_WAKE)) == 0) {
+        // also covers a post whose reason was taken on the previous pass,
+        // and ctrl-C, which raises from mp_handle_pending()
+        mp_handle_pending();
+        uint32_t elapsed = Clock_getTicks() - start;
+        if (elapsed >= ticks) {
+            break;
+        }
+        left = ticks - elapsed;
     }
 }
 
@@ -27,6 +27,8 @@
 #define MICROPY_DEBUG_PRINTERS      (0)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_GC_ALLOC_THRESHOLD  (0)
+// keep call frames off the SDRAM GC heap, see fastram.c
+#define MICROPY_ENABLE_PYSTACK      (1)
 #define MICROPY_REPL_EVENT_DRIVEN   (0)
 #define MICROPY_HELPER_REPL         (1)
 #define MICROPY_REPL_AUTO_INDENT    (1)
@@ -95,8 +97,17 @@
 #define MICROPY_FATFS_MULTI_PARTITION  (1)
 #define MICROPY_FATFS_USE_LABEL        (1)
 
+// cache compiled .py imports as .mpy files beside the source
+#define MICROPY_PERSISTENT_CODE_LOAD   (1)
+#define MICROPY_PERSISTENT_CODE_SAVE   (1)
+#define MICROPY_TI_IMPORT_CACHE        (1)
+
 // use vfs's functions for import stat and builtin open
+#if MICROPY_TI_IMPORT_CACHE
+#define mp_import_stat import_cache_stat
+#else
 #define mp_import_stat mp_vfs_import_stat
+#endif
 #define mp_builtin_open mp_vfs_open
 #define mp_builtin_open_obj mp_vfs_open_obj
 
@@ -203,8 +214,19 @@ extern const struct _mp_obj_module_t mp_module_audio;
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[8]; \
     mp_obj_t pinirq_callback[10]; \
+    void *machine_pin_capture; \
+    mp_obj_t machine_timer_callback[4]; \
+    mp_obj_t machine_timer_error[4]; \
+    mp_obj_t machine_uart_obj[3]; \
+    mp_obj_t machine_adc_stream[3]; \
+    void *machine_spi_queue[3]; \
+    mp_obj_t machine_pwm_play_callback; \
+    void *machine_pwm_play_buf; \
     mp_obj_t tilda_button_callback[22]; \
-    mp_obj_t tilda_config_main;
+    mp_obj_t tilda_config_main; \
+    mp_obj_t ugfx_sprite_list; \
+    mp_obj_t ugfx_sprite_background; \
+    mp_obj_t ugfx_frame_callback;
 
 #ifndef MICROPY_HW_BOARD_NAME
 #define MICROPY_HW_BOARD_NAME "minimal"
@@ -33,7 +33,21 @@ static inline uint32_t ticks_scaled() {
 
 #define mp_hal_ticks_ms() ticks_scaled()
 
-#define mp_hal_ticks_us() (ticks_scaled() * 1000)
+// Clock only ticks once a millisecond, so microseconds come from the 64-bit
+// Timestamp count instead.  Safe to call from a Hwi.
+static inline uint32_t ticks_us_scaled() {
+    xdc_runtime_Types_Timestamp64 now;
+    xdc_runtime_Types_FreqHz freq;
+    Timestamp_get64(&now);
+    Timestamp_getFreq(&freq);
+    uint32_t cycles_per_us = freq.lo / 1000000u;
+    if (cycles_per_us == 0) {
+        cycles_per_us = 1;
+    }
+    return (((uint64_t)now.hi << 32) | now.lo) / cycles_per_us;
+}
+
+#define mp_hal_ticks_us() ticks_us_scaled()
 
 #define mp_hal_ticks_cpu() Timestamp_get32()
 
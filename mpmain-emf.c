@@ -49,7 +49,13 @@
 
 #include "mphalport.h"
 #include "storage.h"
+#include "machine_nvsbdev.h"
+#include "machine_sd.h"
 #include "led.h"
+#include "boot_profile.h"
+#include "console_tx.h"
+#include "fastram.h"
+#include "modmachine.h"
 
 #include "lib/utils/pyexec.h"
 #include "lib/utils/interrupt_char.h"
@@ -110,10 +116,7 @@ int mp_hal_stdin_rx_chr(void)
 
 void mp_hal_stdout_tx_strn(const char * str, size_t len)
 {
-    #if MICROPY_HW_USB_REPL
-    CDCD_sendData(repl_cdc, (const unsigned char *)str, len, 1);
-    #endif
-    UART_write(console, str, len);
+    console_tx_write(str, len, false);
 }
 
 void mp_hal_stdout_tx_str(const char * str)
@@ -123,22 +126,7 @@ void mp_hal_stdout_tx_str(const char * str)
 
 void mp_hal_stdout_tx_strn_cooked(const char * str, size_t len)
 {
-    const char *last = str;
-    while (len--) {
-        if (*str == '\n') {
-            if (str > last) {
-                mp_hal_stdout_tx_strn(last, str - last);
-            }
-            mp_hal_stdout_tx_strn("\r\n", 2);
-            ++str;
-            last = str;
-        } else {
-            ++str;
-        }
-    }
-    if (str > last) {
-        mp_hal_stdout_tx_strn(last, str - last);
-    }
+    console_tx_write(str, len, true);
 }
 
 #if MICROPY_KBD_EXCEPTION
@@ -146,6 +134,8 @@ void mp_hal_stdout_tx_strn_cooked(const char * str, size_t len)
 void usb_ctrlc_handler(uint32_t arg, uint8_t * baseBuf, uint8_t * curBuf,
                        uint32_t avail, uint32_t size)
 {
+    machine_wake(MACHINE_USB_WAKE);
+
     if (mp_interrupt_char == -1) {
         return;
     }
@@ -189,6 +179,7 @@ void NORETURN __fatal_error(const char *msg) {
     led_state(TILDA_LED_GREEN, 1);
     led_state(3, 1);
     led_state(4, 1);
+    console_tx_panic();
     mp_hal_stdout_tx_strn("\nFATAL ERROR:\n", 14);
     mp_hal_stdout_tx_strn(msg, strlen(msg));
     for (uint i = 0;;) {
@@ -274,6 +265,27 @@ MP_NOINLINE STATIC bool init_flash_fs(uint reset_mode) {
     vfs_fat->flags = 0;
     pyb_flash_init_vfs(vfs_fat);
 
+    #if MICROPY_HW_FLASH_FTL
+    // a volume from before the FTL is moved onto a new one, unless it is
+    // being reset anyway; until that works the old one mounts read-only
+    if (flash_bdev_is_legacy() && reset_mode == 3) {
+        if (!flash_bdev_drop_legacy()) {
+            printf("PYB: can't create flash filesystem\n");
+            return false;
+        }
+    } else if (flash_bdev_is_legacy()) {
+        led_state(TILDA_LED_GREEN, 1);
+        int migrated = flash_bdev_migrate(vfs_fat);
+        led_state(TILDA_LED_GREEN, 0);
+        if (migrated == FLASH_MIGRATE_FULL) {
+            printf("PYB: flash filesystem too full to convert, mounted read-only\n"
+                   "PYB: copy your files off and do a factory reset\n");
+        } else if (migrated != FLASH_MIGRATE_OK) {
+            printf("PYB: can't convert flash filesystem, mounted read-only\n");
+        }
+    }
+    #endif
+
     // try to mount the flash
     FRESULT res = f_mount(&vfs_fat->fatfs);
 
@@ -371,6 +383,38 @@ MP_NOINLINE STATIC bool init_flash_fs(uint reset_mode) {
 }
 #endif
 
+#if MICROPY_HW_HAS_SDCARD
+STATIC bool init_sdcard_fs(void) {
+    fs_user_mount_t *vfs_fat = m_new_obj_maybe(fs_user_mount_t);
+    mp_vfs_mount_t *vfs = m_new_obj_maybe(mp_vfs_mount_t);
+    if (vfs == NULL || vfs_fat == NULL) {
+        return false;
+    }
+    vfs_fat->flags = FSUSER_FREE_OBJ;
+    machine_sd_init_vfs(vfs_fat, 0); // first partition, or the whole card
+
+    if (f_mount(&vfs_fat->fatfs) != FR_OK) {
+        m_del_obj(fs_user_mount_t, vfs_fat);
+        m_del_obj(mp_vfs_mount_t, vfs);
+        printf("PYB: can't mount SD card\n");
+        return false;
+    }
+
+    // mount after /flash, which stays the current directory
+    vfs->str = "/sd";
+    vfs->len = 3;
+    vfs->obj = MP_OBJ_FROM_PTR(vfs_fat);
+    vfs->next = NULL;
+    for (mp_vfs_mount_t **m = &MP_STATE_VM(vfs_mount_table);; m = &(*m)->next) {
+        if (*m == NULL) {
+            *m = vfs;
+            break;
+        }
+    }
+    return true;
+}
+#endif
+
 
 
 STATIC uint update_reset_mode(uint reset_mode) {
@@ -452,6 +496,7 @@ int mp_main(void * heap, uint32_t heapsize, uint32_t stacksize, UART_Handle uart
     uint32_t reset_mode;
 
     console = uart;
+    console_tx_init(uart);
     led_init();
 
 #if MICROPY_HW_ENABLE_STORAGE
@@ -466,6 +511,10 @@ int mp_main(void * heap, uint32_t heapsize, uint32_t stacksize, UART_Handle uart
 #else
     repl_cdc = CDCD_open(0, NULL);
 #endif
+    boot_profile_mark("usb");
+    console_tx_start(repl_cdc);
+#else
+    console_tx_start(NULL);
 #endif
 
 
@@ -481,9 +530,11 @@ int mp_main(void * heap, uint32_t heapsize, uint32_t stacksize, UART_Handle uart
     pthread_attr_setstacksize(&tildaAttrs, TILDA_TASK_STACKSIZE);
     pthread_create(&tildaThreadHandle, &tildaAttrs, tildaThread, NULL);
     pthread_attr_destroy(&tildaAttrs);
+    boot_profile_mark("tilda thread");
     #endif
 
 soft_reset:
+    boot_profile_soft_reset();
 
     #if defined(MICROPY_HW_LED2)
     led_state(TILDA_LED_RED, 0);
@@ -520,10 +571,8 @@ soft_reset:
     // GC init
     gc_init(heap, (uint8_t *)heap + heapsize);
 
-    #if MICROPY_ENABLE_PYSTACK
-    static mp_obj_t pystack[384];
-    mp_pystack_init(pystack, &pystack[384]);
-    #endif
+    // pystack and hot buffers in internal SRAM
+    fastram_init0();
 
     // MicroPython init
     mp_init();
@@ -540,22 +589,33 @@ soft_reset:
     tilda_init0();
     #endif
 
+    #if MICROPY_HW_HAS_UGFX
+    extern void ugfx_sprites_init0(void);
+    extern void ugfx_frame_sync_init0(void);
+    ugfx_sprites_init0();
+    ugfx_frame_sync_init0();
+    #endif
+
+    boot_profile_mark("mp_init");
+
     // Initialise the local flash filesystem.
     // Create it if needed, mount in on /flash, and set it as current dir.
     bool mounted_flash = false;
     #if MICROPY_HW_ENABLE_STORAGE
     mounted_flash = init_flash_fs(reset_mode);
+    boot_profile_mark("flash fs");
     #endif
 
     bool mounted_sdcard = false;
     #if MICROPY_HW_HAS_SDCARD
     // if an SD card is present then mount it on /sd/
-    if (sdcard_is_present()) {
+    if (machine_sd_open(MICROPY_HW_SD)) {
         // if there is a file in the flash called "SKIPSD", then we don't mount the SD card
         if (!mounted_flash || f_stat(&fs_user_mount_flash.fatfs, "/SKIPSD", NULL) != FR_OK) {
             mounted_sdcard = init_sdcard_fs();
         }
     }
+    boot_profile_mark("sd fs");
     #endif
 
     #if MICROPY_HW_ENABLE_USB
@@ -583,9 +643,11 @@ soft_reset:
     // TODO perhaps have pyb.reboot([bootpy]) function to soft-reboot and execute custom boot.py
     if (reset_mode == 1 || reset_mode == 3) {
         const char *boot_py = "boot.py";
-        mp_import_stat_t stat = mp_import_stat(boot_py);
+        // run from source, so look past the import cache
+        mp_import_stat_t stat = mp_vfs_import_stat(boot_py);
         if (stat == MP_IMPORT_STAT_FILE) {
             int ret = pyexec_file(boot_py);
+            boot_profile_mark("boot.py");
             if (ret & PYEXEC_FORCED_EXIT) {
                 goto soft_reset_exit;
             }
@@ -618,7 +680,7 @@ soft_reset:
         } else {
             main_py = mp_obj_str_get_str(MP_STATE_PORT(tilda_config_main));
         }
-        mp_import_stat_t stat = mp_import_stat(main_py);
+        mp_import_stat_t stat = mp_vfs_import_stat(main_py);
         if (stat == MP_IMPORT_STAT_FILE) {
             nlr_buf_t nlr;
             nlr_push(&nlr);
@@ -29,6 +29,7 @@
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/mperrno.h"
 
 #if MICROPY_HW_HAS_NEOPIX
 
@@ -48,6 +49,9 @@ static uint16_t * frame_buffer = NULL;
 static uint32_t frame_buffer_size = 0;
 
 static volatile int inprogress = 0;
+static bool ws_ready = false;
+static bool ws_lent = false;
+static HwiP_Handle ws_hwi = NULL;
 
 #define WS_800HZ 800000
 #define WS_400HZ 400000
@@ -76,9 +80,8 @@ STATIC mp_obj_t pyb_neopix_make_new(const mp_obj_type_t *type, mp_uint_t n_args,
     // create object
     pyb_neopix_obj_t *neo = m_new_obj(pyb_neopix_obj_t);
     neo->base.type = &pyb_neopix_type;
-    
-    setup_ws_timer_dma();
-	
+
+    // timer and DMA are set up on the first display()
 	return neo;
 }
 
@@ -117,7 +120,9 @@ static void setup_ws_timer_dma(void)
     MAP_TimerMatchSet(TIMER3_BASE, TIMER_A, WS2812_DUTYCYCLE_RESET);
     
     
-    HwiP_create(INT_TIMER3B, TIMER3B_IRQHandler, NULL);
+    if (ws_hwi == NULL) {
+        ws_hwi = HwiP_create(INT_TIMER3B, TIMER3B_IRQHandler, NULL);
+    }
     MAP_TimerIntEnable(TIMER3_BASE, TIMER_TIMB_DMA);
     
     
@@ -141,6 +146,22 @@ static void setup_ws_timer_dma(void)
 
 }
 
+bool neopix_lend_timer(void)
+{
+    if (inprogress || ws_lent) {
+        return false;
+    }
+    ws_lent = true;
+    // the borrower reconfigures the timer, so set it up again afterwards
+    ws_ready = false;
+    return true;
+}
+
+void neopix_return_timer(void)
+{
+    ws_lent = false;
+}
+
 void ws_start_transfer( uint32_t len){
 
     MAP_TimerMatchSet(TIMER3_BASE, TIMER_A, frame_buffer[0]);
@@ -181,6 +202,15 @@ STATIC mp_obj_t pyb_neopix_display(mp_obj_t self_in, mp_obj_t rgb) {
 	    usleep(100);
         }
 
+    if (ws_lent) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    if (!ws_ready) {
+        setup_ws_timer_dma();
+        ws_ready = true;
+    }
+
 	mp_obj_t *items;
 	
 	if (MP_OBJ_IS_INT(rgb))
@@ -20,4 +20,9 @@
  * THE SOFTWARE.
  */
 
-extern const mp_obj_type_t pyb_neopix_type;
\ No newline at end of file
+extern const mp_obj_type_t pyb_neopix_type;
+
+// TIMER3 is lent to machine.PWM.play() between frames; display() raises
+// EBUSY until it is given back.
+extern bool neopix_lend_timer(void);
+extern void neopix_return_timer(void);
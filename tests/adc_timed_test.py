@@ -0,0 +1,47 @@
+#
+# Timer-triggered ADC sampling. Assumes the two channels configured in
+# board.c (speaker and hall effect).
+#
+
+from machine import ADC
+from array import array
+import time
+
+adc0 = ADC(0)
+adc1 = ADC(1)
+
+# one channel, 1000 samples at 20kHz should take about 50ms
+buf = array('H', bytearray(2000))
+t = time.ticks_ms()
+print(adc0.read_timed(buf, 20000))
+print(40 <= time.ticks_diff(time.ticks_ms(), t) <= 100)
+print(all(0 <= s < 4096 for s in buf))
+
+# two channels sampled on the same timer ticks
+buf0 = array('H', bytearray(200))
+buf1 = array('H', bytearray(200))
+print(ADC.read_timed_multi((adc0, adc1), (buf0, buf1), 10000))
+
+# single samples still work afterwards
+print(0 <= adc0.convert() < 4096, 0 <= adc1.convert() < 4096)
+
+# continuous: callback gets each 256 sample block while the VM keeps running
+blocks = []
+def got(samples):
+    blocks.append(sum(samples) // len(samples))
+
+adc1.stream(got, 25600, 256)
+try:
+    adc0.convert()
+    print("error: convert during stream")
+except OSError:
+    print("pass")
+time.sleep_ms(500)
+missed = adc1.stream(None)
+print(45 <= len(blocks) + missed <= 55, missed)
+
+try:
+    adc0.read_timed(buf, 0)
+    print("error: zero rate")
+except ValueError:
+    print("pass")
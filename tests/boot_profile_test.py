@@ -0,0 +1,23 @@
+import machine
+import tilda
+from time import ticks_ms, ticks_diff
+
+prof = machine.boot_profile()
+for phase, at, took in prof:
+    print("%-20s %8d us %8d us" % (phase, at, took))
+
+names = [p[0] for p in prof]
+print("start" in names and "soft reset" in names)
+print(all(prof[i][1] <= prof[i + 1][1] for i in range(len(prof) - 1)))
+
+machine.boot_profile("test mark")
+print(machine.boot_profile()[-1][0] == "test mark")
+
+# sensors start on first use
+start = ticks_ms()
+t = tilda.Sensors.get_tmp_temperature()
+print("first sensor read", ticks_diff(ticks_ms(), start), "ms")
+print(10 < t < 50)
+start = ticks_ms()
+tilda.Sensors.get_lux()
+print("second sensor read", ticks_diff(ticks_ms(), start), "ms")
@@ -0,0 +1,34 @@
+import machine
+from time import ticks_us, ticks_diff
+
+# a burst that fits in the buffer costs a copy, not the wire time
+line = "x" * 60
+start = ticks_us()
+for i in range(40):
+    print(line)
+took = ticks_diff(ticks_us(), start)
+machine.console(flush=True)
+print("40 lines queued in", took, "us")
+print(took < 20000)
+
+# dropping instead of waiting when the buffer is full
+dropped = machine.console()
+machine.console(overflow=machine.CONSOLE_DROP)
+for i in range(500):
+    print(line)
+print(machine.console(overflow=machine.CONSOLE_BLOCK, flush=True) > dropped)
+
+try:
+    machine.console(overflow=5)
+    print("fail overflow")
+except ValueError:
+    pass
+
+# only over USB for a while; the UART sees none of it, but does see
+# everything queued before the switch
+for i in range(20):
+    print(line)
+machine.console(uart=False)
+print("usb only")
+machine.console(uart=True, flush=True)
+print("both")
@@ -0,0 +1,43 @@
+import machine
+import gc
+from time import ticks_us, ticks_diff
+
+N = 4096
+
+def checksum(buf):
+    s = 0
+    for i in range(len(buf)):
+        s += buf[i]
+        buf[i] = s & 0xff
+    return s
+
+def bench(name, buf):
+    for i in range(len(buf)):
+        buf[i] = i & 0xff
+    start = ticks_us()
+    s = checksum(buf)
+    took = ticks_diff(ticks_us(), start)
+    print("%-8s %6d us" % (name, took))
+    return took, s
+
+sdram, s1 = bench("sdram", bytearray(N))
+sram, s2 = bench("sram", machine.fastram(N))
+print(s1 == s2)
+print("speedup %d%%" % ((sdram - sram) * 100 // sdram))
+
+# call frames come from the pystack in SRAM, so deep calls don't touch the
+# GC heap at all
+def fib(n):
+    return n if n < 2 else fib(n - 1) + fib(n - 2)
+
+gc.collect()
+before = gc.mem_alloc()
+start = ticks_us()
+fib(18)
+print("fib(18) %d us" % ticks_diff(ticks_us(), start))
+print(gc.mem_alloc() - before < 64)
+
+try:
+    machine.fastram(1 << 20)
+except MemoryError:
+    print("MemoryError")
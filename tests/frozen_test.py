@@ -0,0 +1,17 @@
+import gc
+import sys
+
+# heap used importing each frozen library module; compare against the same
+# module imported from /flash/lib on a build without FROZEN_LIB_DIR
+for name in ('app', 'buttons', 'database', 'dialogs', 'homescreen', 'http',
+             'sleep', 'ugfx_helper', 'wifi'):
+    gc.collect()
+    before = gc.mem_free()
+    try:
+        mod = __import__(name)
+    except ImportError:
+        print(name, "not available")
+        continue
+    gc.collect()
+    print(name, before - gc.mem_free(), "bytes", getattr(mod, '__file__', 'frozen'))
+    del sys.modules[name]
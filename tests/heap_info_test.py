@@ -0,0 +1,35 @@
+import machine
+import ugfx
+
+# the original form, the TI-RTOS heap
+total, free, largest = machine.heap_info()
+print(largest <= free <= total)
+print(machine.heap_info("rtos")[0] == total)
+
+info = machine.heaps()
+for name in sorted(info):
+    total, free, largest, frag = info[name]
+    print("%-8s %8d total %8d free %8d largest %3d%% frag" % (name, total, free, largest, frag))
+print(sorted(info) == ["fastram", "gc", "rtos", "ugfx"])
+print(all(0 <= v[3] <= 100 and v[2] <= v[1] <= v[0] for v in info.values()))
+
+# uGFX objects come from their own pool, not the TI-RTOS heap
+ugfx.init()
+rtos = machine.heap_info("rtos")[1]
+before = machine.heap_info("ugfx")[1]
+b = ugfx.Button(10, 10, 80, 30, "test")
+print(machine.heap_info("ugfx")[1] <= before)
+print(machine.heap_info("rtos")[1] == rtos)
+b.destroy()
+
+# slabs stay with uGFX once carved, so a second Button reuses the first
+# one's slots and leaves the pool as it was
+after = machine.heap_info("ugfx")[1]
+b = ugfx.Button(10, 10, 80, 30, "test")
+b.destroy()
+print(machine.heap_info("ugfx")[1] == after)
+
+try:
+    machine.heap_info("nope")
+except KeyError:
+    print("KeyError")
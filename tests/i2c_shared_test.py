@@ -0,0 +1,34 @@
+#
+# The internal bus is shared with the TiLDA background thread, which keeps
+# polling the buttons and sensors while python uses it.
+#
+
+from machine import I2C
+import tilda
+import time
+
+i2c = I2C(0)
+print(i2c)
+
+found = i2c.scan()
+for addr in (0x20, 0x40, 0x48, 0x6b):
+    print(hex(addr), addr in found)
+
+# hammer the bus while the background thread is running; every batch has
+# to come back whole
+tmp = bytearray(2)
+hdc = bytearray(4)
+errors = 0
+t = time.ticks_ms()
+for i in range(500):
+    try:
+        i2c.transfer_batch([
+            (0x48, b'\x00', tmp),
+            (0x40, b'\x00', hdc),
+        ])
+    except OSError:
+        errors += 1
+print(errors, time.ticks_diff(time.ticks_ms(), t) < 5000)
+
+# the background readings carry on regardless
+print(tilda.Sensors.get_tmp_temperature() > -999)
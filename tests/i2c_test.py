@@ -45,3 +45,18 @@ check = i2c.readfrom_mem(addr, 0x38, 1)
 print(check)
 check = i2c.readfrom_mem(addr, 0x39, 1)
 print(check)
+
+# the same register reads as one batch, into preallocated buffers
+reg = bytearray(1)
+user = bytearray(5)
+i2c.transfer_batch([
+    (addr, b'\x00', reg),
+    (addr, b'\x38', user),
+    (addr, b'\x38\x01', None),
+])
+print(reg[0] == 0xf8, user)
+
+try:
+    i2c.transfer_batch([(addr, b'\x00', reg), (0x7f, b'\x00', reg)])
+except OSError as e:
+    print("failed segment", e.args[1])
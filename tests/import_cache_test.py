@@ -0,0 +1,71 @@
+import os
+import sys
+from time import ticks_ms, ticks_diff
+
+def write(name, text):
+    with open(name, 'w') as f:
+        f.write(text)
+
+def forget(name):
+    if name in sys.modules:
+        del sys.modules[name]
+
+for f in ('cache_mod.py', 'cache_mod.mpy'):
+    try:
+        os.remove(f)
+    except OSError:
+        pass
+
+write('cache_mod.py', 'X = 1\n' + 'def f(a):\n    return a * 2\n' * 50)
+
+start = ticks_ms()
+import cache_mod
+print("first import", ticks_diff(ticks_ms(), start), "ms")
+print(cache_mod.X == 1)
+print('cache_mod.mpy' in os.listdir())
+
+forget('cache_mod')
+start = ticks_ms()
+import cache_mod
+print("cached import", ticks_diff(ticks_ms(), start), "ms")
+print(cache_mod.f(21) == 42)
+
+# changing the source invalidates the cache
+write('cache_mod.py', 'X = 22\n')
+forget('cache_mod')
+import cache_mod
+print(cache_mod.X == 22)
+
+# syntax errors still come from the source
+write('cache_mod.py', 'X = (\n')
+forget('cache_mod')
+try:
+    import cache_mod
+except SyntaxError:
+    print("SyntaxError")
+
+# a cache file is not imported once its source is deleted
+write('cache_mod.py', 'X = 3\n')
+forget('cache_mod')
+import cache_mod
+os.remove('cache_mod.py')
+forget('cache_mod')
+try:
+    import cache_mod
+    print("fail orphan imported")
+except ImportError:
+    print("ImportError")
+print('cache_mod.mpy' not in os.listdir())
+
+# a .mpy the user put there is never overwritten
+with open('cache_mod.mpy', 'wb') as f:
+    f.write(b'user')
+write('cache_mod.py', 'X = 4\n')
+forget('cache_mod')
+import cache_mod
+print(cache_mod.X == 4)
+with open('cache_mod.mpy', 'rb') as f:
+    print(f.read() == b'user')
+
+os.remove('cache_mod.py')
+os.remove('cache_mod.mpy')
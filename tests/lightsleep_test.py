@@ -0,0 +1,29 @@
+import machine
+from machine import Timer
+
+# times out on its own
+slept = machine.lightsleep(200)
+print(190 <= slept <= 210)
+print(machine.wake_reason() == machine.RTC_WAKE)
+
+# a timer is a wake source only if asked for
+t = Timer(0, mode=Timer.ONE_SHOT, period=50, callback=lambda t: None)
+slept = machine.lightsleep(200, wake=machine.TIMER_WAKE)
+print(slept < 100, machine.wake_reason() == machine.TIMER_WAKE)
+
+t = Timer(0, mode=Timer.ONE_SHOT, period=50, callback=lambda t: None)
+slept = machine.lightsleep(200, wake=(machine.PIN_WAKE, machine.USB_WAKE))
+print(slept >= 190, machine.wake_reason() == machine.RTC_WAKE)
+
+total = machine.asleep_ms()
+machine.lightsleep(100)
+print(machine.asleep_ms() - total >= 95)
+
+print("press a button within 10s")
+machine.lightsleep(10000, wake=machine.PIN_WAKE)
+print(machine.wake_reason() == machine.PIN_WAKE)
+
+try:
+    machine.lightsleep(10, wake=99)
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,24 @@
+from machine import Pin
+from array import array
+from time import sleep_ms
+
+events = array('I', [0] * 3 * 64)
+count = 0
+
+def drain(index):
+    global count
+    n = Pin.capture_read(events)
+    for i in range(n):
+        pin, level, ticks = events[3 * i:3 * i + 3]
+        print(pin, level, ticks)
+    count += n
+
+pin = Pin(0)
+pin.irq(drain, capture=True)
+
+while count < 10:
+    sleep_ms(100)
+
+pin.irq(None)
+print("lost", Pin.capture_lost())
+print("done")
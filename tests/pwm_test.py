@@ -29,3 +29,36 @@ print(pwm.freq() == 8000)
 print(pwm.duty() == 66)
 
 pwm.duty(0)
+
+# waveforms: a fade up and back down, played out by uDMA
+from array import array
+from time import sleep_ms
+
+fade = array('H', [i * 655 for i in range(100)] + [65535 - i * 655 for i in range(100)])
+
+done = []
+pwm.freq(10000)
+pwm.play(fade, 1000, callback=lambda p: done.append(p))
+print(pwm.playing())
+sleep_ms(300)
+print(not pwm.playing())
+print(done == [pwm])
+
+# longer than one uDMA transfer, looped, then stopped
+ramp = array('H', range(0, 65535, 16))
+pwm.play(ramp, 20000, True)
+sleep_ms(500)
+print(pwm.playing())
+pwm.play(None)
+print(not pwm.playing())
+
+try:
+    PWM(1).play(fade, 1000)
+    PWM(0).play(fade, 1000)
+    PWM(1).play(fade, 1000)
+except OSError:
+    print("busy")
+PWM(0).play(None)
+PWM(1).play(None)
+
+pwm.duty(0)
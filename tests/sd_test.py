@@ -0,0 +1,38 @@
+# needs a card in SD instance 0; the last 8 blocks are overwritten and
+# put back
+import os
+from machine import SD
+
+sd = SD(0)
+n = sd.ioctl(4, 0)
+size = sd.ioctl(5, 0)
+print(size == 512)
+
+first = n - 8
+saved = sd.readblocks(first, 8 * size)
+
+# one multi-block read matches block by block reads
+for i in range(8):
+    if sd.readblocks(first + i, size) != saved[i * size:(i + 1) * size]:
+        print("fail block", i)
+
+# a multi-block write updates blocks already held in the cache
+sd.readblocks(first + 3, size)
+pattern = bytes(i & 0xff for i in range(8 * size))
+sd.writeblocks(first, pattern)
+print(sd.readblocks(first + 3, size) == pattern[3 * size:4 * size])
+print(sd.readblocks(first, 8 * size) == pattern)
+
+sd.writeblocks(first, saved)
+print(sd.readblocks(first, 8 * size) == saved)
+
+try:
+    sd.writeblocks(first, bytes(100))
+    print("fail short write")
+except ValueError:
+    pass
+
+# mounted at boot, ahead of /flash on the path
+import sys
+print("sd" in os.listdir("/"))
+print(sys.path.index("/sd") < sys.path.index("/flash"))
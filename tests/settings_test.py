@@ -0,0 +1,45 @@
+from machine import Settings
+
+s = Settings()
+s.clear()
+print(s.keys() == [])
+
+s.set("name", "badge")
+s.set("blob", b"\x00\x01\x02")
+s.set(42, 1234)
+s.set("score", -5)
+print(s.get("name") == "badge")
+print(s.get("blob") == b"\x00\x01\x02")
+print(s.get(42) == 1234)
+print(s.get("score") == -5)
+print(s.get("missing") is None)
+print(s.get("missing", 7) == 7)
+
+s.set("score", None)
+print(s.get("score") is None)
+print(sorted(str(k) for k in s.keys()) == ["42", "blob", "name"])
+
+# enough writes to wrap both banks several times
+for i in range(2000):
+    s.set("score", i)
+print(s.get("score") == 1999)
+print(s.get("name") == "badge")
+print(s.get(42) == 1234)
+
+# survives a new instance
+print(Settings().get("blob") == b"\x00\x01\x02")
+
+try:
+    s.set("x" * 33, 1)
+    print("fail long key")
+except ValueError:
+    pass
+
+try:
+    s.set("big", bytes(257))
+    print("fail long value")
+except ValueError:
+    pass
+
+s.clear()
+print(s.get("name") is None)
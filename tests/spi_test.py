@@ -25,3 +25,32 @@ spi.write(data)
 
 buf = bytearray(8)
 spi.write_readinto(data, buf)
+
+# queued transfers: the calls return straight away and the callbacks run
+# once each transfer has finished, in order
+from machine import Pin
+cs = Pin(0, Pin.OUT, value=1)
+
+done = []
+def finished(buf):
+    done.append(len(buf))
+
+spi.write_async(b'\x01\x02', finished, cs=cs)
+spi.readinto_async(bytearray(16), finished, cs=cs)
+spi.write_readinto_async(data, bytearray(8), finished)
+print(spi.pending() <= 3)
+spi.wait()
+print(spi.pending())
+import time
+time.sleep_ms(10)
+print(done)
+
+# an empty write does nothing; an empty async one is refused up front
+# and doesn't stall the queue
+spi.write(b'')
+try:
+    spi.write_async(b'', finished)
+except ValueError:
+    print("ValueError")
+spi.write(data)
+print(spi.pending())
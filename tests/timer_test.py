@@ -0,0 +1,52 @@
+import machine
+from machine import Timer
+from time import sleep_ms
+
+ticks = 0
+def tick(t):
+    global ticks
+    ticks += 1
+
+# soft periodic callback
+t = Timer(0, mode=Timer.PERIODIC, freq=100, callback=tick)
+sleep_ms(205)
+t.deinit()
+print(19 <= ticks <= 21)
+count, missed, min_us, max_us, jitter = t.stats()
+print(count == ticks, missed == 0)
+print("interval %d..%d us, jitter %d us" % (min_us, max_us, jitter))
+
+# one-shot
+ticks = 0
+t = Timer(1, mode=Timer.ONE_SHOT, period=10, callback=tick)
+sleep_ms(50)
+print(ticks == 1)
+
+# hard callback: runs in the interrupt, must not allocate
+hard_ticks = [0]
+def hard(t):
+    hard_ticks[0] += 1
+
+t = Timer(2, period_us=500, callback=hard, hard=True)
+sleep_ms(100)
+t.deinit()
+print(190 <= hard_ticks[0] <= 210)
+print(t.stats()[4] < 50)
+
+# an exception in a hard callback stops the timer, and is printed once
+# the interrupt is over
+def bad(t):
+    [1] * 10
+
+t = Timer(3, period=1, callback=bad, hard=True)
+sleep_ms(10)
+print(t.stats()[0] == 1)
+
+try:
+    Timer(4)
+except OSError:
+    print("OSError")
+try:
+    Timer(0, period_us=0, callback=tick)
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,51 @@
+#
+# Loop TX back to RX on UART 2 (external header) with a jumper wire.
+#
+
+from machine import UART
+from time import sleep_ms
+
+u = UART(2, 115200, mode=UART.BINARY, timeout=100, rxbuf=2048)
+print(u)
+
+# readline stops at each newline however the data arrived
+u.write(b"$GPGGA,1\n$GPRMC,2\npartial")
+print(u.readline())
+print(u.readline())
+print(u.readline())     # no newline: whatever arrived by the timeout
+print(u.readline())     # nothing at all
+
+# readinto fills a preallocated buffer from the ring
+buf = bytearray(8)
+u.write(b"0123456789")
+print(u.readinto(buf), buf)
+print(u.read())
+
+# a burst bigger than the FIFO survives while the VM is busy elsewhere
+data = bytes(range(256)) * 4
+u.write(data)
+sleep_ms(200)
+print(u.any(), u.read(len(data)) == data)
+
+# RX_ANY fires as data comes in, RX_IDLE once the line goes quiet
+events = []
+def handler(uart):
+    events.append(uart.any())
+
+u.irq(handler, UART.RX_IDLE)
+u.write(b"hello")
+sleep_ms(20)
+print(events, u.read())
+
+u.irq(None)
+u.write(b"quiet")
+sleep_ms(20)
+print(len(events), u.read())
+
+# this board does not route RTS/CTS on any UART
+try:
+    u.init(115200, flow=UART.RTS | UART.CTS)
+except OSError:
+    print("No flow control support")
+
+u.deinit()
@@ -0,0 +1,39 @@
+import ugfx
+from array import array
+from time import ticks_ms, ticks_diff
+
+ugfx.init()
+ugfx.clear(ugfx.BLACK)
+
+cmds = array('h')
+for i in range(0, 240, 4):
+    cmds.extend((ugfx.BATCH_LINE, 0, i, 319, 239 - i, ugfx.GREEN))
+cmds.extend((ugfx.BATCH_FILL_CIRCLE, 160, 120, 30, ugfx.RED))
+cmds.extend((ugfx.BATCH_BOX, 10, 10, 50, 20, ugfx.WHITE))
+
+start = ticks_ms()
+print(ugfx.draw_batch(cmds) == 62)
+print("batch", ticks_diff(ticks_ms(), start), "ms")
+
+start = ticks_ms()
+for i in range(0, 240, 4):
+    ugfx.line(0, i, 319, 239 - i, ugfx.GREEN)
+print("calls", ticks_diff(ticks_ms(), start), "ms")
+
+# replay offset
+print(ugfx.draw_batch(array('h', [ugfx.BATCH_BOX, 0, 0, 10, 10, ugfx.BLUE]), 100, 100) == 1)
+
+# stops at BATCH_END
+print(ugfx.draw_batch(array('h', [ugfx.BATCH_PIXEL, 1, 1, ugfx.RED, ugfx.BATCH_END, 99])) == 1)
+
+try:
+    ugfx.draw_batch(array('h', [99, 0, 0]))
+    print("error: bad opcode accepted")
+except ValueError:
+    print("pass")
+
+try:
+    ugfx.draw_batch(array('h', [ugfx.BATCH_LINE, 0, 0]))
+    print("error: truncated command accepted")
+except ValueError:
+    print("pass")
@@ -0,0 +1,37 @@
+import ugfx
+import math
+from array import array
+from time import ticks_ms, ticks_diff
+
+ugfx.init()
+ugfx.clear(ugfx.WHITE)
+
+g = ugfx.Graph(10, 10, 300, 220, 0, 110)
+g.appearance(ugfx.Graph.STYLE_POINT, ugfx.Graph.POINT_NONE, 0, 0)
+g.appearance(ugfx.Graph.STYLE_LINE, ugfx.Graph.LINE_SOLID, 0, ugfx.BLUE)
+g.show()
+
+# list input still works
+g.plot([0, 10, 20], [0, 20, -20])
+g.plot(30, 0)
+
+ys = array('h', (int(100 * math.sin(i / 300)) for i in range(4000)))
+start = ticks_ms()
+g.plot(None, ys, True, decimate=True)
+print("4000 samples", ticks_diff(ticks_ms(), start), "ms")
+
+xs = array('f', (i * 0.5 for i in range(200)))
+yf = array('f', (50 * math.cos(i / 20) for i in range(200)))
+g.plot(xs, yf, True)
+
+try:
+    g.plot(array('h', [1, 2]), array('h', [1]))
+except ValueError:
+    print("ValueError")
+
+try:
+    g.plot(None, array('i', [1, 2]))
+except ValueError:
+    print("ValueError")
+
+g.destroy()
@@ -0,0 +1,34 @@
+import ugfx
+import math
+from array import array
+
+ugfx.init()
+ugfx.clear(ugfx.BLACK)
+
+# star with 200 points, well past the old 20 point limit
+star = array('h')
+for i in range(200):
+    r = 100 if i % 2 else 40
+    a = i * math.pi / 100
+    star.append(int(r * math.cos(a)))
+    star.append(int(r * math.sin(a)))
+
+ugfx.fill_polygon(160, 120, star, ugfx.YELLOW)
+ugfx.polygon(160, 120, star, ugfx.RED)
+
+# concave arrow from a list of tuples
+arrow = [(0, 0), (40, 20), (0, 40), (10, 20)]
+ugfx.fill_polygon(10, 10, arrow, ugfx.GREEN)
+ugfx.polygon(10, 10, arrow, ugfx.WHITE)
+
+try:
+    ugfx.polygon(0, 0, array('f', [0, 0, 1, 1]), ugfx.RED)
+    print("error: float array accepted")
+except TypeError:
+    print("pass")
+
+c = ugfx.Container(0, 0, 100, 100)
+c.show()
+c.fill_polygon(50, 50, star, ugfx.BLUE)
+c.destroy()
+print("done")
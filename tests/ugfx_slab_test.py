@@ -0,0 +1,24 @@
+import ugfx
+import machine
+
+ugfx.init()
+
+def screen():
+    w = [ugfx.Button(10, 10 + i * 30, 100, 25, "b%d" % i) for i in range(6)]
+    w.append(ugfx.Label(120, 10, 100, 20, "label"))
+    w.append(ugfx.List(120, 40, 100, 100))
+    for x in w:
+        x.destroy()
+
+screen()
+heap = machine.heap_info("ugfx")
+slabs = [s[1] for s in ugfx.slab_info()]
+
+# the second time round every small block comes from an existing slab
+for i in range(10):
+    screen()
+print(machine.heap_info("ugfx") == heap)
+print([s[1] for s in ugfx.slab_info()] == slabs)
+
+for size, nslabs, in_use, peak, allocs in ugfx.slab_info():
+    print("%4d %3d slabs %4d in use %4d peak %6d allocs" % (size, nslabs, in_use, peak, allocs))
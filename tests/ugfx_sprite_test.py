@@ -0,0 +1,51 @@
+import ugfx
+from array import array
+from time import ticks_ms, ticks_diff
+
+ugfx.init()
+ugfx.clear(ugfx.BLACK)
+ugfx.sprite_background(ugfx.BLACK)
+
+# 8x8 red square with a transparent (black) border
+pixels = array('H', [ugfx.BLACK] * 64)
+for y in range(1, 7):
+    for x in range(1, 7):
+        pixels[y * 8 + x] = ugfx.RED
+
+try:
+    ugfx.Sprite(pixels, 16, 16)
+    print("error: small buffer accepted")
+except ValueError:
+    print("pass")
+
+s1 = ugfx.Sprite(pixels, 8, 8, key=ugfx.BLACK)
+s2 = ugfx.Sprite(pixels, 8, 8, key=ugfx.BLACK, scale=4)
+print(s2.scale() == 4)
+for bad in (0, 256):
+    try:
+        s2.scale(bad)
+        print("fail scale", bad)
+    except ValueError:
+        pass
+try:
+    ugfx.Sprite(pixels, 8, 8, scale=256)
+    print("fail scale 256")
+except ValueError:
+    pass
+
+s1.show()
+s2.show()
+
+start = ticks_ms()
+for i in range(100):
+    s1.move(i * 3, 50)
+    s2.move(200 - i, 100 + i // 2)
+    ugfx.sprite_draw_all()
+print("100 frames in", ticks_diff(ticks_ms(), start), "ms")
+
+print(s1.x() == 297, s1.y() == 50)
+
+s1.hide()
+s2.hide()
+ugfx.sprite_draw_all()
+print("done")
@@ -0,0 +1,40 @@
+import ugfx
+
+ugfx.init()
+ugfx.clear(ugfx.BLACK)
+
+# first present has nothing to compare against
+print(ugfx.present() == 0)
+
+x = 0
+def draw():
+    global x
+    ugfx.area(x, 100, 20, 20, ugfx.BLACK)
+    x = (x + 4) % 300
+    ugfx.area(x, 100, 20, 20, ugfx.RED)
+
+periods = [ugfx.present(draw) for i in range(60)]
+print("present avg", sum(periods) // len(periods), "us")
+
+# panel refresh is ~70Hz by default
+period = ugfx.frame_period()
+print(10000 < period < 20000)
+
+frames = 0
+def on_frame(_):
+    global frames
+    frames += 1
+
+ugfx.frame_sync(on_frame)
+import time
+time.sleep(1)
+ugfx.frame_sync(None)
+print(40 < frames < 100)
+
+# and with nothing waiting on it the TE interrupt is switched off
+print(ugfx.frame_period() == 0)
+
+try:
+    ugfx.frame_sync(1)
+except TypeError:
+    print("TypeError")
@@ -0,0 +1,36 @@
+import ugfx
+from tilda import Buttons
+from time import ticks_ms, ticks_diff, sleep_ms
+
+ugfx.init()
+lst = ugfx.List(10, 10, 200, 200, up=Buttons.JOY_Up, down=Buttons.JOY_Down)
+for i in range(5):
+    lst.add_item("item %d" % i)
+
+# no poll timer: the list only moves when a button interrupt jabs the
+# toggle driver
+print("press JOY_Down within 10s")
+start = lst.selected_index()
+deadline = ticks_ms() + 10000
+pressed_at = None
+while ticks_diff(deadline, ticks_ms()) > 0:
+    if pressed_at is None and Buttons.is_pressed(Buttons.JOY_Down):
+        pressed_at = ticks_ms()
+    if lst.selected_index() != start:
+        break
+    sleep_ms(1)
+print(lst.selected_index() != start)
+if pressed_at is not None:
+    print("latency %d ms" % ticks_diff(ticks_ms(), pressed_at))
+
+# python callbacks still only fire on the edges asked for
+events = []
+Buttons.enable_interrupt(Buttons.JOY_Up, lambda b: events.append(b), on_press=True, on_release=False)
+print("press and release JOY_Up within 10s")
+deadline = ticks_ms() + 10000
+while not events and ticks_diff(deadline, ticks_ms()) > 0:
+    sleep_ms(10)
+sleep_ms(500)
+print(events == [Buttons.JOY_Up])
+Buttons.disable_interrupt(Buttons.JOY_Up)
+lst.destroy()
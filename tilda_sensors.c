@@ -115,6 +115,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_charge_status_obj, tilda_sens
 
 STATIC mp_obj_t tilda_sensors_get_tmp_temperature()
 {
+    tildaSensorsStart();
     return mp_obj_new_float(tildaSharedStates.tmpTemperature);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_tmp_temperature_obj, tilda_sensors_get_tmp_temperature);
@@ -122,6 +123,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_tmp_temperature_obj, tilda_se
 
 STATIC mp_obj_t tilda_sensors_get_hdc_temperature()
 {
+    tildaSensorsStart();
     return mp_obj_new_float(tildaSharedStates.hdcTemperature);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_hdc_temperature_obj, tilda_sensors_get_hdc_temperature);
@@ -129,6 +131,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_hdc_temperature_obj, tilda_se
 
 STATIC mp_obj_t tilda_sensors_get_hdc_humidity()
 {
+    tildaSensorsStart();
     return mp_obj_new_float(tildaSharedStates.hdcHumidity);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_hdc_humidity_obj, tilda_sensors_get_hdc_humidity);
@@ -136,6 +139,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_hdc_humidity_obj, tilda_senso
 
 STATIC mp_obj_t tilda_sensors_get_lux()
 {
+    tildaSensorsStart();
     return mp_obj_new_float(tildaSharedStates.optLux);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(tilda_sensors_get_lux_obj, tilda_sensors_get_lux);
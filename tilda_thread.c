@@ -33,6 +33,8 @@
 /* Driver Header files */
 #include <ti/drivers/GPIO.h>
 #include <ti/drivers/I2C.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Clock.h>
 
 /* Example/Board Header files */
 #include "MSP_EXP432E401Y.h"
@@ -46,6 +48,8 @@
 #include "tilda_sensors.h"
 
 #include "pdb.h"
+#include "modmachine.h"
+#include "i2c_bus.h"
 
 Event_Struct evtStruct;
 I2C_Handle      i2cHandle;
@@ -77,14 +81,65 @@ void tilda_init0()
    }
 }
 
+// Set once the uGFX toggle driver is running; it is then told about every
+// button change straight from the interrupt path instead of polling
+static bool toggleFeed;
+
+static void toggleWakeup(bool fromIsr)
+{
+#if MICROPY_HW_HAS_UGFX
+    extern void ginputToggleWakeup(void);
+    extern void ginputToggleWakeupI(void);
+    if (toggleFeed) {
+        if (fromIsr) {
+            ginputToggleWakeupI();
+        }
+        else {
+            ginputToggleWakeup();
+        }
+    }
+#endif
+}
+
+// GPIO buttons interrupt on both edges; the press/release filtering for
+// python callbacks is done here
 static void tildaGpioCallback(uint8_t index) {
     uint8_t button = index + Buttons_JOY_Center;
+    bool pressed = getButtonState(button);
+
+    toggleWakeup(true);
+
     mp_obj_t *tilda_button_callback = &MP_STATE_PORT(tilda_button_callback)[button];
-    if (*tilda_button_callback != mp_const_none) {
+    if (*tilda_button_callback != mp_const_none
+        && (pressed ? tildaButtonCallbackModes[button].on_press : tildaButtonCallbackModes[button].on_release)) {
         mp_sched_schedule(*tilda_button_callback, MP_OBJ_NEW_SMALL_INT(button));
+        machine_wake(MACHINE_PIN_WAKE);
+    }
+    else if (pressed) {
+        // any press ends a lightsleep
+        machine_wake(MACHINE_PIN_WAKE);
+    }
+}
+
+static void enableGpioButtonInt(uint8_t gpioIndex)
+{
+    GPIO_PinConfig cfg;
+    GPIO_getConfig(gpioIndex, &cfg);
+    cfg = (cfg & (~GPIO_CFG_INT_MASK)) | GPIO_CFG_IN_INT_BOTH_EDGES;
+    GPIO_setConfig(gpioIndex, cfg);
+
+    GPIO_disableInt(gpioIndex);
+    GPIO_setCallback(gpioIndex, tildaGpioCallback);
+    GPIO_enableInt(gpioIndex);
+}
+
+// Called by the uGFX toggle driver when it starts
+void tildaToggleFeedStart()
+{
+    toggleFeed = true;
+    for (uint8_t button = Buttons_JOY_Center; button < Buttons_MAX; button++) {
+        enableGpioButtonInt(button - Buttons_JOY_Center);
     }
-    extern Semaphore_Handle machine_sleep_sem;
-    Semaphore_post(machine_sleep_sem);
 }
 
 void tcaInterruptHandler(uint8_t index)
@@ -117,7 +172,7 @@ void readTCAButtons()
     i2cTransaction.writeCount = 1;
     i2cTransaction.readBuf = readBuffer;
     i2cTransaction.readCount = 2;
-    bool status = I2C_transfer(i2cHandle, &i2cTransaction);
+    bool status = I2CBus_transfer(&i2cTransaction, 1, NULL, I2CBus_PRIORITY_HIGH);
     if (status == false) {
         // Unsuccessful I2C transfer
         return;
@@ -142,7 +197,7 @@ static void writeTMPReg(uint8_t addr, uint8_t byte1, uint8_t byte2)
     i2cTransaction.writeCount = 3;
     i2cTransaction.readBuf = NULL;
     i2cTransaction.readCount = 0;
-    I2C_transfer(i2cHandle, &i2cTransaction);
+    I2CBus_transfer(&i2cTransaction, 1, NULL, I2CBus_PRIORITY_LOW);
 }
 
 static bool readTMPReg(uint8_t addr, uint8_t *byte1, uint8_t *byte2)
@@ -157,7 +212,7 @@ static bool readTMPReg(uint8_t addr, uint8_t *byte1, uint8_t *byte2)
     i2cTransaction.writeCount = 1;
     i2cTransaction.readBuf = readBuffer;
     i2cTransaction.readCount = 2;
-    bool res = I2C_transfer(i2cHandle, &i2cTransaction);
+    bool res = I2CBus_transfer(&i2cTransaction, 1, NULL, I2CBus_PRIORITY_LOW);
     if (res == false) {
         return false;
     }
@@ -202,7 +257,7 @@ static void readBQ()
     trans.writeCount = 1;
     trans.readBuf = tildaSharedStates.bqRegs;
     trans.readCount = sizeof(tildaSharedStates.bqRegs);
-    I2C_transfer(i2cHandle, &trans);
+    I2CBus_transfer(&trans, 1, NULL, I2CBus_PRIORITY_LOW);
 }
 
 
@@ -220,40 +275,30 @@ static void writeHDCReg(uint8_t addr, uint8_t data)
     i2cTransaction.writeCount = 2;
     i2cTransaction.readBuf = NULL;
     i2cTransaction.readCount = 0;
-    I2C_transfer(i2cHandle, &i2cTransaction);
-}
-
-static bool readHDCRegMulti(uint8_t addr, uint8_t *data, uint8_t cnt)
-{
-    uint8_t writeBuffer[1];
-    writeBuffer[0] = addr;
-
-    I2C_Transaction i2cTransaction;
-    i2cTransaction.slaveAddress = 0x40;
-    i2cTransaction.writeBuf = writeBuffer;
-    i2cTransaction.writeCount = 1;
-    i2cTransaction.readBuf = data;
-    i2cTransaction.readCount = cnt;
-    bool res = I2C_transfer(i2cHandle, &i2cTransaction);
-    if (res == false) {
-        return false;
-    }
-    return true;
+    I2CBus_transfer(&i2cTransaction, 1, NULL, I2CBus_PRIORITY_LOW);
 }
 
 static bool HDC2080_getReadings(float *temperature, float *humidity)
 {
+    // temperature and humidity in one go, so they come from the same
+    // conversion
+    uint8_t reg_t = HDC2080_TEMPERATURE_LSB_REG;
+    uint8_t reg_h = HDC2080_HUMIDITY_LSB_REG;
     uint8_t data_t[2];
-    bool res = readHDCRegMulti(HDC2080_TEMPERATURE_LSB_REG, data_t, 2);
-    if (res == false){
-        *temperature = -999;
-        *humidity = -999;
-        return false;
-    }
-
     uint8_t data_h[2];
-    res = readHDCRegMulti(HDC2080_HUMIDITY_LSB_REG, data_h, 2);
-    if (res == false){
+
+    I2C_Transaction trans[2];
+    trans[0].slaveAddress = 0x40;
+    trans[0].writeBuf = &reg_t;
+    trans[0].writeCount = 1;
+    trans[0].readBuf = data_t;
+    trans[0].readCount = 2;
+    trans[1].slaveAddress = 0x40;
+    trans[1].writeBuf = &reg_h;
+    trans[1].writeCount = 1;
+    trans[1].readBuf = data_h;
+    trans[1].readCount = 2;
+    if (I2CBus_transfer(trans, 2, NULL, I2CBus_PRIORITY_LOW) != 2) {
         *temperature = -999;
         *humidity = -999;
         return false;
@@ -268,10 +313,106 @@ static bool HDC2080_getReadings(float *temperature, float *humidity)
     return true;
 }
 
-void *tildaThread(void *arg)
+// The environmental sensors are set up after the first sample period,
+// once boot has moved on, or straight away if python asks for a reading
+// before that.  Readings are only handed over once every sensor has
+// finished a real conversion: the HDC2080 says so with data ready, the
+// OPT3001 (800 ms at most) and TMP102 are just given time.  A read that
+// comes in while that is going on waits for it.
+#define SENSOR_SETTLE_MS    (900)
+#define SENSOR_HDC_MAX_MS   (2500)  // don't wait forever on a missing HDC2080
+#define SENSOR_POLL_MS      (50)
+
+static bool sensorsStarted;
+static bool sensorsStarting;
+static bool sensorsHdcReady;
+static uint32_t sensorsStartTicks;
+static Semaphore_Struct sensorStartSemStruct;
+static Semaphore_Handle sensorStartSem;
+static OPT3001_Handle opt3001Handle;
+
+static void startSensors()
 {
-    I2C_Params      i2cParams;
+    // register HDC2080 Int handler
+    GPIO_disableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
+    GPIO_setCallback(MSP_EXP432E401Y_GPIO_HDC_INT, hdcInterruptHandler);
+    GPIO_enableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
 
+    // reset the HDC
+    writeHDCReg(HDC2080_RST_DRDY_INT_CONF_REG, HDC2080_RST_DRDY_INT_CONF_SOFT_RES);
+    usleep(3000U);
+    // set interrupt on data ready
+    writeHDCReg(HDC2080_INT_MASK_REG, (1<<7));
+    // set temp and humid to max resolution
+    writeHDCReg(HDC2080_MEAS_CONFIG_REG, 0);
+    // set the HDC to 1Hz continuous mode, enable interrupt output
+    writeHDCReg(HDC2080_RST_DRDY_INT_CONF_REG, HDC2080_RST_DRDY_INT_CONF_AMM_1
+                                               | HDC2080_RST_DRDY_INT_CONF_DRDY_EN
+                                               | HDC2080_RST_DRDY_INT_CONF_INT_POL);
+    //start conversion
+    writeHDCReg(HDC2080_MEAS_CONFIG_REG, HDC2080_MEAS_CONFIG_START_MEAS);
+
+    // set the TMP102 to 1Hz continuous mode, max range
+    //   turn off shutdown (and enable continuous conversion)
+    writeTMPReg(TMP_CONFIG_REG, 0, TMP_CFG_CR_1Hz | TMP_CFG_EM);
+
+    // the OPT3001 driver uses the handle directly
+    OPT3001_Params opt3001Params;
+    OPT3001_Params_init(&opt3001Params);
+    I2CBus_acquire(I2CBus_PRIORITY_LOW);
+    opt3001Handle = OPT3001_open(MSP_EXP432E401Y_OPT3001_0, i2cHandle,
+            &opt3001Params);
+    I2CBus_release();
+}
+
+static void readSensors()
+{
+    // grab TMP temp readings
+    TMP102_getTemperature(&tildaSharedStates.tmpTemperature);
+
+    // grab lux readings
+    if (opt3001Handle) {
+        I2CBus_acquire(I2CBus_PRIORITY_LOW);
+        OPT3001_getLux(opt3001Handle, &tildaSharedStates.optLux);
+        I2CBus_release();
+    }
+
+    // kick off Humidity conversion
+    HDC2080_getReadings(&tildaSharedStates.hdcTemperature, &tildaSharedStates.hdcHumidity);
+}
+
+// While quiesced (machine.lightsleep) the thread only wakes for interrupts,
+// not to poll the sensors and charger
+static volatile bool quiesced;
+
+void tildaQuiesce(bool quiesce)
+{
+    quiesced = quiesce;
+    // the HDC2080 raises data ready every second in continuous mode
+    if (sensorsStarted) {
+        if (quiesce) {
+            GPIO_disableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
+        }
+        else {
+            GPIO_enableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
+        }
+    }
+    // re-pend with the new timeout
+    Event_post(tildaEvtHandle, Event_QUIESCE);
+}
+
+// Called from python before returning any sensor reading; blocks until
+// the sensors have been set up and have finished their first conversions
+void tildaSensorsStart()
+{
+    if (!sensorsStarted) {
+        Event_post(tildaEvtHandle, Event_SENSOR_START);
+        Semaphore_pend(sensorStartSem, BIOS_WAIT_FOREVER);
+    }
+}
+
+void *tildaThread(void *arg)
+{
     tildaSharedStates.sampleRate = 500; // default to 0.5 Sec sample rate
     tildaSharedStates.optLux = 0.0;  // in case OPT3001 is not working
 
@@ -279,10 +420,14 @@ void *tildaThread(void *arg)
     Event_construct(&evtStruct, NULL);
     tildaEvtHandle = Event_handle(&evtStruct);
 
-    // Init Internal I2C bus
-    I2C_Params_init(&i2cParams);
-    i2cParams.bitRate = I2C_400kHz;
-    i2cHandle = I2C_open(MSP_EXP432E401Y_I2C4, &i2cParams);
+    Semaphore_Params semParams;
+    Semaphore_Params_init(&semParams);
+    semParams.mode = Semaphore_Mode_BINARY;
+    Semaphore_construct(&sensorStartSemStruct, 0, &semParams);
+    sensorStartSem = Semaphore_handle(&sensorStartSemStruct);
+
+    // Init Internal I2C bus, shared with machine.I2C
+    i2cHandle = I2CBus_open();
     // if (i2cHandle == NULL) {
     //     // Display_printf(display, 0, 0, "Error Initializing I2C\n");
     //     while (1);
@@ -300,45 +445,13 @@ void *tildaThread(void *arg)
     GPIO_setCallback(MSP_EXP432E401Y_GPIO_TCA_INT, pdbStart);
     GPIO_enableInt(MSP_EXP432E401Y_GPIO_TCA_INT);
 
-    // register HDC2080 Int handler
-    GPIO_disableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
-    GPIO_setCallback(MSP_EXP432E401Y_GPIO_HDC_INT, hdcInterruptHandler);
-    GPIO_enableInt(MSP_EXP432E401Y_GPIO_HDC_INT);
-
     // setup charger?
     readBQ();
 
-    // setup sensors
-
-    // reset the HDC
-    writeHDCReg(HDC2080_RST_DRDY_INT_CONF_REG, HDC2080_RST_DRDY_INT_CONF_SOFT_RES);
-    usleep(3000U);
-    // set interrupt on data ready
-    writeHDCReg(HDC2080_INT_MASK_REG, (1<<7));
-    // set temp and humid to max resolution
-    writeHDCReg(HDC2080_MEAS_CONFIG_REG, 0);
-    // set the HDC to 1Hz continuous mode, enable interrupt output
-    writeHDCReg(HDC2080_RST_DRDY_INT_CONF_REG, HDC2080_RST_DRDY_INT_CONF_AMM_1
-                                               | HDC2080_RST_DRDY_INT_CONF_DRDY_EN
-                                               | HDC2080_RST_DRDY_INT_CONF_INT_POL);
-    //start conversion
-    writeHDCReg(HDC2080_MEAS_CONFIG_REG, HDC2080_MEAS_CONFIG_START_MEAS);
-
-    // set the TMP102 to 1Hz continuous mode, max range
-    //   turn off shutdown (and enable continuous conversion)
-    writeTMPReg(TMP_CONFIG_REG, 0, TMP_CFG_CR_1Hz | TMP_CFG_EM);
-
-
     // do an inital button read
     readTCAButtons();
     lastButtonState = buttonState;
 
-    OPT3001_Handle opt3001Handle = NULL;
-    OPT3001_Params opt3001Params;
-    OPT3001_Params_init(&opt3001Params);
-    opt3001Handle = OPT3001_open(MSP_EXP432E401Y_OPT3001_0, i2cHandle,
-            &opt3001Params);
-
     uint32_t posted;
     bool scheduled;
 
@@ -347,12 +460,25 @@ void *tildaThread(void *arg)
         // wait for TCA or HDC evnt or time out (default 500ms, might be settable)
         posted = Event_pend(tildaEvtHandle,
             Event_Id_NONE,                                  /* andMask */
-            Event_BQ_INT + Event_TCA_INT + Event_HDC_INT,   /* orMack */
-            tildaSharedStates.sampleRate);
+            Event_BQ_INT + Event_TCA_INT + Event_HDC_INT + Event_SENSOR_START + Event_QUIESCE,   /* orMack */
+            sensorsStarting ? SENSOR_POLL_MS
+                : quiesced ? BIOS_WAIT_FOREVER : tildaSharedStates.sampleRate);
+
+        // first sample period over, or first use of a sensor from python
+        if ((posted == 0 || (posted & Event_SENSOR_START))
+            && !sensorsStarted && !sensorsStarting) {
+            startSensors();
+            sensorsStarting = true;
+            sensorsHdcReady = false;
+            sensorsStartTicks = Clock_getTicks();
+        }
 
         // if TCA event
         if (posted & Event_TCA_INT) {
             readTCAButtons();
+            if (buttonState != lastButtonState) {
+                toggleWakeup(false);
+            }
             scheduled = false;
             //  fire any callbacks if needed
             //  comparing new and last buttons states
@@ -370,40 +496,48 @@ void *tildaThread(void *arg)
                     }
                 }
             }
-            // wake the mp?
-            if (scheduled) {
-                extern Semaphore_Handle machine_sleep_sem;
-                Semaphore_post(machine_sleep_sem);
+            // wake the mp?  any press ends a lightsleep
+            if (scheduled || (quiesced && buttonState != lastButtonState)) {
+                machine_wake(MACHINE_PIN_WAKE);
             }
         }
 
         // else if bq event
         if (posted & Event_BQ_INT) {
             readBQ();
+            // USB plugged in or out
+            if (quiesced) {
+                machine_wake(MACHINE_USB_WAKE);
+            }
         }
 
         // else if hdc data ready
         if (posted & Event_HDC_INT){
             // grab temp and hum readings
             HDC2080_getReadings(&tildaSharedStates.hdcTemperature, &tildaSharedStates.hdcHumidity);
+            sensorsHdcReady = true;
+        }
+
+        // first conversions done, hand the readings to python
+        if (sensorsStarting) {
+            uint32_t ms = (uint64_t)(Clock_getTicks() - sensorsStartTicks) * Clock_tickPeriod / 1000;
+            if (ms >= SENSOR_SETTLE_MS && (sensorsHdcReady || ms >= SENSOR_HDC_MAX_MS)) {
+                readSensors();
+                sensorsStarting = false;
+                sensorsStarted = true;
+                Semaphore_post(sensorStartSem);
+            }
+            continue;
         }
 
         // else if time out
         if (posted == 0) {
-            // grab TMP temp readings
-            TMP102_getTemperature(&tildaSharedStates.tmpTemperature);
-
-            // grab lux readings
-            if (opt3001Handle) {
-                OPT3001_getLux(opt3001Handle, &tildaSharedStates.optLux);
+            if (sensorsStarted) {
+                readSensors();
             }
 
             // grab battery updates?
             readBQ();
-
-            // kick off Humidity conversion
-            HDC2080_getReadings(&tildaSharedStates.hdcTemperature, &tildaSharedStates.hdcHumidity);
-
         }
     }
 
@@ -449,31 +583,8 @@ void registerButtonCallback(uint8_t button, mp_obj_t tca_callback_irq,  bool on_
     tildaButtonCallbackModes[button].on_press = on_press;
     tildaButtonCallbackModes[button].on_release = on_release;
     if (button >= Buttons_JOY_Center) {
-        uint8_t gpioIndex = button - Buttons_JOY_Center;
-        // This is a GPIO attached button need to do some extra setup
-
-        // call GPIO_setConfig to setup the Interupt direction
-        GPIO_PinConfig cfg;
-        GPIO_getConfig(gpioIndex, &cfg);
-
-        cfg = (cfg & (~GPIO_CFG_INT_MASK)); // clear INT
-        if (button == Buttons_BTN_Menu) {
-            if (on_press)
-                cfg |= GPIO_CFG_IN_INT_FALLING;
-            if (on_release)
-                cfg |= GPIO_CFG_IN_INT_RISING;
-        } else {
-            if (on_press)
-                cfg |= GPIO_CFG_IN_INT_RISING;
-            if (on_release)
-                cfg |= GPIO_CFG_IN_INT_FALLING;
-        }
-        GPIO_setConfig(gpioIndex, cfg);
-
-        // register our generic callback handler
-        GPIO_disableInt(gpioIndex);
-        GPIO_setCallback(gpioIndex, tildaGpioCallback);
-        GPIO_enableInt(gpioIndex);
+        // This is a GPIO attached button, it needs its interrupt enabling
+        enableGpioButtonInt(button - Buttons_JOY_Center);
     }
 }
 
@@ -485,7 +596,7 @@ void unregisterButtonCallback(uint8_t button)
     tildaButtonCallbackModes[button].on_press = false;
     tildaButtonCallbackModes[button].on_release = false;
 
-    if (button >= Buttons_JOY_Center) {
+    if (button >= Buttons_JOY_Center && !toggleFeed) {
         uint8_t gpioIndex = button - Buttons_JOY_Center;
         // This is a GPIO attached button need to do some extra cleanup
         GPIO_disableInt(gpioIndex);
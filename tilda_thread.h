@@ -38,6 +38,8 @@
 #define Event_TCA_INT   Event_Id_00
 #define Event_BQ_INT    Event_Id_01
 #define Event_HDC_INT   Event_Id_02
+#define Event_SENSOR_START  Event_Id_03
+#define Event_QUIESCE   Event_Id_04
 
 #ifdef __cplusplus
 extern "C" {
@@ -96,6 +98,9 @@ volatile tilda_shared_states_t tildaSharedStates;
 
 void tilda_init0();
 void * tildaThread(void *arg);
+void tildaSensorsStart();
+void tildaQuiesce(bool quiesce);
+void tildaToggleFeedStart();
 
 uint32_t getAllButtonStates();
 bool getButtonState(TILDA_BUTTONS_Names button);